@@ -31,27 +31,61 @@ static const char *TAG = "i2c-example";
 #define I2C_MASTER_FREQ_HZ CONFIG_I2C_MASTER_FREQUENCY        /*!< I2C master clock frequency */
 #define I2C_MASTER_TX_BUF_DISABLE 0                           /*!< I2C master doesn't need buffer */
 #define I2C_MASTER_RX_BUF_DISABLE 0                           /*!< I2C master doesn't need buffer */
+#define I2C_MASTER_READ_BATCH CONFIG_I2C_MASTER_READ_BATCH    /*!< register reads chained into one bus session */
 
 SemaphoreHandle_t print_mux = NULL;
 
-static esp_err_t i2c_master_read_slave(i2c_port_t i2c_num, uint8_t command, uint8_t *data_rd, size_t size)
+typedef struct {
+    uint8_t command;    /*!< command byte written before the repeated START */
+    uint8_t *data;      /*!< where the answer goes */
+    size_t size;        /*!< bytes to read, 0 skips the entry */
+} i2c_master_reg_read_t;
+
+/*
+ * Command link storage for one bus session, the link is encoded here instead of on the heap.
+ * The legacy driver keeps the transfer progress inside the link items, so a link cannot be replayed:
+ * it is re-armed by encoding the next session in place, which costs a few list writes and no allocation.
+ */
+static uint8_t i2c_master_link_buf[I2C_LINK_RECOMMENDED_SIZE(2 * I2C_MASTER_READ_BATCH)];
+
+/**
+ * @brief chain register reads into one bus session
+ *
+ * START, then for each read: address + W, command, repeated START, address + R, data.
+ * The next read follows with a repeated START, a single STOP ends the session.
+ */
+static esp_err_t i2c_master_read_slave_batch(i2c_port_t i2c_num, const i2c_master_reg_read_t *reads, size_t count)
 {
-    if (size == 0) {
-        return ESP_OK;
+    if (count == 0 || count > I2C_MASTER_READ_BATCH) {
+        return ESP_ERR_INVALID_ARG;
     }
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);                                                      //send start bit
-    i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_WRITE, true); //send the bms address and write bit
-    i2c_master_write_byte(cmd, command, true);                                  //send the command to read
-    i2c_master_start(cmd);                                                      //send restart
-    i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_READ, true);  //send the bms address and read bit
-    if(size > 1) {
-        i2c_master_read(cmd, data_rd, size - 1, I2C_MASTER_ACK);                //if more than one byte is to be read request one less than the number of bytes required
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(i2c_master_link_buf, sizeof(i2c_master_link_buf));
+    if (cmd == NULL) {
+        return ESP_ERR_NO_MEM;
     }
-    i2c_master_read(cmd, &data_rd[size - 1], 1, I2C_MASTER_NACK);               //request the last byte and send a NACK
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, portMAX_DELAY);
-    i2c_cmd_link_delete(cmd);
+    bool empty = true;
+    for (size_t i = 0; i < count; i++) {
+        const i2c_master_reg_read_t *rd = &reads[i];
+        if (rd->size == 0) {
+            continue;
+        }
+        empty = false;
+        i2c_master_start(cmd);                                                      //send start bit, or restart after the previous read
+        i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_WRITE, true); //send the bms address and write bit
+        i2c_master_write_byte(cmd, rd->command, true);                              //send the command to read
+        i2c_master_start(cmd);                                                      //send restart
+        i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_READ, true);  //send the bms address and read bit
+        if (rd->size > 1) {
+            i2c_master_read(cmd, rd->data, rd->size - 1, I2C_MASTER_ACK);           //if more than one byte is to be read request one less than the number of bytes required
+        }
+        i2c_master_read(cmd, &rd->data[rd->size - 1], 1, I2C_MASTER_NACK);          //request the last byte and send a NACK
+    }
+    esp_err_t ret = ESP_OK;
+    if (!empty) {
+        i2c_master_stop(cmd);
+        ret = i2c_master_cmd_begin(i2c_num, cmd, portMAX_DELAY);
+    }
+    i2c_cmd_link_delete_static(cmd);
     return ret;
 }
 
@@ -102,12 +136,22 @@ static esp_err_t i2c_slave_init(void)
 
 static void i2c_master_task(void *arg)
 {
-    uint8_t data_rd[1] = {0};
+    uint8_t data_rd[I2C_MASTER_READ_BATCH] = {0};
+    i2c_master_reg_read_t reads[I2C_MASTER_READ_BATCH];
     uint8_t command = 0x00;
     while (1) {
-        ++command;
-        i2c_master_read_slave(I2C_MASTER_NUM, command, data_rd, 1);
-        ESP_LOGI(TAG, "Master Send Command: %02x, Return: %02x", command, data_rd[0]);
+        for (int i = 0; i < I2C_MASTER_READ_BATCH; i++) {
+            reads[i].command = ++command;
+            reads[i].data = &data_rd[i];
+            reads[i].size = 1;
+        }
+        esp_err_t ret = i2c_master_read_slave_batch(I2C_MASTER_NUM, reads, I2C_MASTER_READ_BATCH);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Master read session failed: %s", esp_err_to_name(ret));
+        }
+        for (int i = 0; i < I2C_MASTER_READ_BATCH; i++) {
+            ESP_LOGI(TAG, "Master Send Command: %02x, Return: %02x", reads[i].command, data_rd[i]);
+        }
         vTaskDelay(200 / portTICK_PERIOD_MS);
     }
     vTaskDelete(NULL);
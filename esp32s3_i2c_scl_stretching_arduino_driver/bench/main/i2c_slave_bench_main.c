@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp32-hal-i2c-slave.h"
+#include "i2c_slave_sim.h"
+#include "sdkconfig.h"
+
+#define BENCH_PORT      0
+#define BENCH_ADDR      0x28
+#define BENCH_BUF_LEN   1024
+
+#if CONFIG_BENCH_EVENT_NOTIFY
+#define BENCH_EVENTS    "notify"
+#else
+#define BENCH_EVENTS    "queue"
+#endif
+#if CONFIG_BENCH_FIFO_ADAPTIVE
+#define BENCH_FIFO      "adaptive"
+#else
+#define BENCH_FIFO      "fixed"
+#endif
+
+typedef struct {
+    const char * name;
+    uint16_t write_len;     // bytes written, the first one is the command of a read
+    uint16_t read_len;      // bytes read after a repeated START
+    uint8_t read_percent;   // share of the transactions that are reads
+} bench_mix_t;
+
+static const bench_mix_t bench_mixes[] = {
+#if !CONFIG_BENCH_MIX_CUSTOM_ONLY
+    { "write 8",      8,   0,   0   },
+    { "write 256",    256, 0,   0   },
+    { "read 8",       1,   8,   100 },
+    { "read 128",     1,   128, 100 },
+    { "mixed 16/16",  16,  16,  50  },
+#endif
+#if CONFIG_BENCH_MIX_CUSTOM
+    { "custom",       CONFIG_BENCH_MIX_WRITE_LEN, CONFIG_BENCH_MIX_READ_LEN, CONFIG_BENCH_MIX_READ_PERCENT },
+#endif
+};
+
+static const struct {
+    const char * name;
+    i2c_slave_rx_mode_t mode;
+    i2c_slave_rx_delivery_t delivery;
+} bench_rx_modes[] = {
+    { "ringbuf",    I2C_SLAVE_RX_RINGBUF, I2C_SLAVE_RX_DELIVERY_COPY },
+    { "ringbuf-zc", I2C_SLAVE_RX_RINGBUF, I2C_SLAVE_RX_DELIVERY_ZERO_COPY },
+    { "queue",      I2C_SLAVE_RX_QUEUE,   I2C_SLAVE_RX_DELIVERY_COPY },
+    { "ring",       I2C_SLAVE_RX_RING,    I2C_SLAVE_RX_DELIVERY_COPY },
+    { "ring-zc",    I2C_SLAVE_RX_RING,    I2C_SLAVE_RX_DELIVERY_ZERO_COPY },
+};
+
+static uint8_t tx_pattern[BENCH_BUF_LEN];
+static volatile uint16_t bench_read_len;
+static volatile uint32_t bench_rx_bytes;
+
+static void bench_on_request(uint8_t num, uint8_t *cmd, uint8_t cmd_len, void * arg)
+{
+    i2cSlaveWrite(num, tx_pattern, bench_read_len, 0);
+}
+
+static void bench_on_receive(uint8_t num, uint8_t * data, size_t len, bool stop, void * arg)
+{
+    bench_rx_bytes += len;
+}
+
+// one row: RX buffer x transaction mix, returns the number of transactions that went wrong
+static uint32_t bench_run(const char * rx_name, i2c_slave_rx_mode_t rx_mode, i2c_slave_rx_delivery_t delivery, const bench_mix_t * mix)
+{
+    uint8_t wr[BENCH_BUF_LEN];
+    uint8_t rd[BENCH_BUF_LEN];
+    uint32_t errors = 0, bytes = 0;
+
+    for(size_t i = 0; i < sizeof(wr); i++){
+        wr[i] = (uint8_t)(i * 7);
+    }
+    bench_read_len = mix->read_len;
+    bench_rx_bytes = 0;
+
+    i2cSlaveSetRxMode(BENCH_PORT, rx_mode);
+    i2cSlaveSetRxDelivery(BENCH_PORT, delivery);
+#if CONFIG_BENCH_EVENT_NOTIFY
+    i2cSlaveSetEventDelivery(BENCH_PORT, I2C_SLAVE_EVENT_NOTIFY, 0);
+#endif
+#if CONFIG_BENCH_FIFO_ADAPTIVE
+    i2cSlaveSetFifoThresholds(BENCH_PORT, 0, 0, true);
+#endif
+    i2cSlaveAttachCallbacks(BENCH_PORT, bench_on_request, bench_on_receive, NULL);
+    i2c_slave_config_t config = I2C_SLAVE_CONFIG_DEFAULT(0, 1, BENCH_ADDR);
+    config.frequency = 400000;
+    config.rx_len = BENCH_BUF_LEN;
+    config.tx_len = BENCH_BUF_LEN;
+    esp_err_t err = i2cSlaveInitEx(BENCH_PORT, &config);
+    if(err != ESP_OK){
+        printf("%-10s %-12s init failed %d\n", rx_name, mix->name, err);
+        return CONFIG_BENCH_TRANSACTIONS;
+    }
+    i2cSlaveResetStats(BENCH_PORT);
+    i2c_slave_sim_reset_stats(BENCH_PORT);
+
+    int64_t start = i2c_slave_sim_time_us();
+    for(uint32_t i = 0; i < CONFIG_BENCH_TRANSACTIONS; i++){
+        bool read = (i % 100) < mix->read_percent;
+        size_t rd_len = read ? mix->read_len : 0;
+        size_t wr_len = read ? 1 : mix->write_len;
+        if(i2c_slave_sim_master_transfer(BENCH_PORT, BENCH_ADDR, wr, wr_len, rd, rd_len) != ESP_OK
+            || (rd_len && memcmp(rd, tx_pattern, rd_len))){
+            errors++;
+        }
+        bytes += wr_len + rd_len;
+    }
+    int64_t elapsed = i2c_slave_sim_time_us() - start;
+    if(elapsed <= 0){
+        elapsed = 1;
+    }
+    //let the worker deliver the last write
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    i2c_slave_stats_t stats;
+    i2c_slave_sim_stats_t sim;
+    i2cSlaveGetStats(BENCH_PORT, &stats);
+    i2c_slave_sim_get_stats(BENCH_PORT, &sim);
+    i2cSlaveDeinit(BENCH_PORT);
+
+    printf("%-10s %-12s %10.0f %10.1f %8.1f %8" PRIu32 " %6" PRIu32 " %6" PRIu32 " %6" PRIu32 " %6" PRIu32 "\n",
+        rx_name, mix->name,
+        CONFIG_BENCH_TRANSACTIONS * 1e6 / elapsed,
+        bytes * 1e6 / 1024 / elapsed,
+        sim.stretches ? (double)sim.stretch_total_us / sim.stretches : 0.0,
+        sim.stretch_max_us,
+        stats.rx_overflows + sim.rx_overruns,
+        stats.event_overflows,
+        sim.tx_underruns,
+        errors);
+    return errors;
+}
+
+void app_main(void)
+{
+    uint32_t errors = 0;
+
+    for(size_t i = 0; i < sizeof(tx_pattern); i++){
+        tx_pattern[i] = (uint8_t)(0xA5 ^ i);
+    }
+    printf("%" PRIu32 " transactions per run, events %s, FIFO watermarks %s\n", (uint32_t)CONFIG_BENCH_TRANSACTIONS, BENCH_EVENTS, BENCH_FIFO);
+    printf("%-10s %-12s %10s %10s %8s %8s %6s %6s %6s %6s\n",
+        "rx", "mix", "trans/s", "KiB/s", "str_avg", "str_max", "rx_ovf", "ev_ovf", "tx_und", "errors");
+    for(size_t m = 0; m < sizeof(bench_rx_modes) / sizeof(bench_rx_modes[0]); m++){
+        for(size_t i = 0; i < sizeof(bench_mixes) / sizeof(bench_mixes[0]); i++){
+            errors += bench_run(bench_rx_modes[m].name, bench_rx_modes[m].mode, bench_rx_modes[m].delivery, &bench_mixes[i]);
+        }
+    }
+    //non zero exit status for CI
+    exit(errors ? 1 : 0);
+}
@@ -12,7 +12,6 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "soc/soc_caps.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -24,10 +23,6 @@
 
 #include "sdkconfig.h"
 #include "esp_attr.h"
-#include "rom/gpio.h"
-#include "soc/gpio_sig_map.h"
-#include "hal/gpio_types.h"
-#include "driver/gpio.h"
 #include "esp_err.h"
 
 #include "freertos/FreeRTOS.h"
@@ -36,31 +31,19 @@
 #include "freertos/semphr.h"
 #include "freertos/ringbuf.h"
 
-#include "esp_intr_alloc.h"
-#include "soc/i2c_reg.h"
-#include "soc/i2c_struct.h"
-#include "hal/i2c_ll.h"
-#include "hal/clk_gate_ll.h"
-#include "driver/gpio.h"
 #include "esp32-hal-i2c-slave.h"
-#include "esp_timer.h"
+#include "i2c_slave_hal.h"
+#include "i2c_slave_ring.h"
+#include "smbus_pec.h"
 #include "esp_log.h"
+#include "esp_idf_version.h"
 
-const char* TAG = "i2c_slave";
+static const char* TAG = "i2c_slave";
 
-#define I2C_SLAVE_USE_RX_QUEUE 0 // 1: Queue, 0: RingBuffer
-
-#if SOC_I2C_NUM > 1
-#define I2C_SCL_IDX(p)  ((p==0)?I2CEXT0_SCL_OUT_IDX:((p==1)?I2CEXT1_SCL_OUT_IDX:0))
-#define I2C_SDA_IDX(p) ((p==0)?I2CEXT0_SDA_OUT_IDX:((p==1)?I2CEXT1_SDA_OUT_IDX:0))
+#if CONFIG_I2C_SLAVE_ISR_IN_IRAM
+#define I2C_SLAVE_ISR_ATTR IRAM_ATTR
 #else
-#define I2C_SCL_IDX(p)  I2CEXT0_SCL_OUT_IDX
-#define I2C_SDA_IDX(p) I2CEXT0_SDA_OUT_IDX
-#endif
-
-#if CONFIG_IDF_TARGET_ESP32
-    #define I2C_TXFIFO_WM_INT_ENA    I2C_TXFIFO_EMPTY_INT_ENA
-    #define I2C_RXFIFO_WM_INT_ENA     I2C_RXFIFO_FULL_INT_ENA
+#define I2C_SLAVE_ISR_ATTR
 #endif
 
 //#define DEBUG_MODE
@@ -69,65 +52,143 @@ const char* TAG = "i2c_slave";
 #define DEBUG_IO2 9
 #endif
 
+#define I2C_SLAVE_EVENT_DEPTH_DEFAULT 16
+
 enum {
-    I2C_SLAVE_EVT_RX, I2C_SLAVE_EVT_TX
+    I2C_SLAVE_EVT_RX, I2C_SLAVE_EVT_TX, I2C_SLAVE_EVT_SKIP, I2C_SLAVE_EVT_REGMAP, I2C_SLAVE_EVT_TX_REFILL, I2C_SLAVE_EVT_RX_CHUNK
 };
 
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-#define i2c_ll_set_filter i2c_ll_master_set_filter
-#define i2c_ll_cal_bus_clk i2c_ll_master_cal_bus_clk
-#define i2c_ll_set_bus_timing i2c_ll_master_set_bus_timing
-#define i2c_ll_set_fifo_mode i2c_ll_slave_set_fifo_mode
-#define i2c_ll_clr_intsts_mask i2c_ll_clear_intr_mask 
-#define i2c_clk_cal_t i2c_hal_clk_config_t
-#define I2C_SCLK_APB SOC_MOD_CLK_APB
-#define I2C_SCLK_XTAL SOC_MOD_CLK_XTAL
-#endif
+#define I2C_SLAVE_SLOT_FRONT 0x1 // buffer index the ISR answers from
+#define I2C_SLAVE_SLOT_BUSY  0x2 // the ISR is copying the front buffer
+
+typedef struct {
+    uint32_t ctrl;
+    uint16_t len[2];
+} i2c_slave_slot_t;
 
 typedef struct i2c_slave_struct_t {
     i2c_dev_t * dev;
     uint8_t num;
+    const char * tag;               // per-port log tag, also the worker task name
     int8_t sda;
     int8_t scl;
+    uint16_t slave_addr;
     i2c_slave_request_cb_t request_callback;
     i2c_slave_receive_cb_t receive_callback;
+    i2c_slave_request_ex_cb_t request_callback_ex;
+    i2c_slave_receive_ex_cb_t receive_callback_ex;
     void * arg;
+    i2c_slave_isr_request_cb_t isr_request_callback;
+    void * isr_arg;
+    uint8_t isr_cmd[I2C_SLAVE_ISR_CMD_MAX_LEN]; // first bytes of the current write, for isr_request_callback and slots
+    uint8_t isr_cmd_len;
     intr_handle_t intr_handle;
-    TaskHandle_t task_handle;
-    QueueHandle_t event_queue;
-#if I2C_SLAVE_USE_RX_QUEUE
-    QueueHandle_t rx_queue;
-#else
-    RingbufHandle_t rx_ring_buf;
-#endif
-    QueueHandle_t tx_queue;
+    TaskHandle_t task_handle;       // worker task, NULL when worker_disabled
+    TaskHandle_t event_task;        // notified on I2C_SLAVE_EVENT_NOTIFY, the worker or the task in i2cSlaveReadAcquire
+    bool worker_disabled;           // events are taken by the application with i2cSlaveReadAcquire
+    bool read_held;                 // an i2cSlaveReadAcquire span is not released yet
+    bool polled;                    // no interrupt, i2c_slave_poll_task services the peripheral and dispatches events inline
+    int8_t poll_core;               // core i2c_slave_poll_task is pinned to
+    bool idle_wdt_removed;          // the idle task of poll_core was taken off the task watchdog
+    uint8_t * static_mem;           // i2cSlaveInitEx arena, buffers are carved from it instead of the heap
+    size_t static_left;
+    StaticTask_t task_static;
+    StaticQueue_t event_queue_static;
+    StaticQueue_t rx_queue_static;
+    StaticRingbuffer_t rx_ring_buf_static;
+    i2c_slave_event_mode_t event_mode;
+    size_t event_depth;             // pending events, 0 for I2C_SLAVE_EVENT_DEPTH_DEFAULT
+    QueueHandle_t event_queue;      // I2C_SLAVE_EVENT_QUEUE
+    i2c_slave_ring_t event_ring;    // I2C_SLAVE_EVENT_NOTIFY, whole i2c_slave_queue_event_t records
+    i2c_slave_rx_mode_t rx_mode;
+    QueueHandle_t rx_queue;         // I2C_SLAVE_RX_QUEUE
+    RingbufHandle_t rx_ring_buf;    // I2C_SLAVE_RX_RINGBUF
+    i2c_slave_ring_t rx_ring;       // I2C_SLAVE_RX_RING
+    i2c_slave_ring_t tx_ring;
+    i2c_slave_tx_producer_cb_t tx_producer;
+    void * tx_producer_arg;
+    uint32_t tx_low_water;          // ask the worker for more stream bytes below this many queued bytes
+    size_t tx_stream_offset;        // bytes produced for the current master read
+    bool tx_stream_active;          // the producer has not ended the current master read yet
+    bool tx_refill_pending;         // an I2C_SLAVE_EVT_TX_REFILL event is queued
+    bool tx_refill_stretched;       // SCL is held on an empty TX FIFO until the refill
+    uint32_t tx_staged;             // bytes past the tx_ring head not published yet, i2cSlaveWriteAppend/i2cSlaveWritev
+    bool tx_staging;                // i2cSlaveWriteBegin holds the port lock until commit or abort
     uint32_t rx_data_count;
+    i2c_slave_rx_chunk_cb_t rx_chunk_callback;
+    void * rx_chunk_arg;
+    uint32_t rx_chunk_len;          // hand the write over every rx_chunk_len bytes, 0 when not streaming
+    bool rx_chunked;                // the current write was partly handed over, its end must be reported
+    size_t rx_stream_offset;        // bytes of the current write already delivered, only touched by the worker
 #if !CONFIG_DISABLE_HAL_LOCKS
     SemaphoreHandle_t lock;
 #endif
+    i2c_slave_rx_delivery_t rx_delivery;
+    uint8_t * pool;         // CONFIG_I2C_SLAVE_POOL_BUFFERS transaction buffers of pool_buf_len bytes
+    size_t pool_buf_len;
+    uint32_t pool_free;     // bitmask of free pool buffers, only touched by the worker
+    uint8_t rx_fifo_thr_cfg;        // i2cSlaveSetFifoThresholds, 0 for the frequency based default
+    uint8_t tx_fifo_thr_cfg;
+    bool fifo_thr_adaptive;
+    uint8_t rx_fifo_thr;            // RX FIFO watermark in use, interrupt once it holds this many bytes
+    uint8_t tx_fifo_thr;            // TX FIFO watermark in use, interrupt once it holds no more than this
+    uint8_t rx_fifo_clean;          // long writes in a row without an RX FIFO full stretch
+    uint8_t tx_fifo_clean;          // long reads in a row without a TX FIFO empty stretch
+    bool rx_fifo_stretched;         // the current transaction stretched on a full RX FIFO
+    bool tx_fifo_stretched;         // the current transaction stretched on an empty TX FIFO
+    uint32_t trans_rx_bytes;        // bytes written by the master in the current transaction
+    uint32_t trans_tx_bytes;        // bytes loaded into the TX FIFO for the current master read, i2cSlaveResetStats does not touch it
+    bool pec_enabled;               // SMBus PEC checked on writes and appended to reads
+    bool rx_pec_started;            // rx_pec holds the address byte of the current transaction
+    uint8_t rx_pec;                 // PEC of the current transaction so far, 0 once the PEC byte is in
+    uint8_t tx_pec;                 // PEC of the current master read so far, FIFO and TX ring
+    uint8_t tx_pec_fifo;            // PEC of the bytes of the current master read loaded into the TX FIFO
+    i2c_slave_stats_t stats;
+    uint32_t stretch_start_cycles;  // i2c_slave_cycles() at the pending master read stretch
+    int stretch_core;               // core that took stretch_start_cycles
+    int64_t stretch_start_us;       // esp_timer time of the stretch, only set when it is handed to the worker
+    bool stretch_timed;             // stretch_start_cycles belongs to a stretch not released yet
+    portMUX_TYPE spinlock;          // shared with the ISR, guards the register map
+    uint8_t * regmap;               // register map mode when not NULL
+    uint32_t regmap_size;
+    i2c_slave_regmap_cb_t regmap_callback;
+    void * regmap_arg;
+    uint32_t regmap_ptr;            // auto-incrementing register pointer
+    bool regmap_ptr_next;           // the next written byte sets regmap_ptr
+    uint32_t regmap_tx_pushed;      // bytes of the current master read pushed to the TX FIFO
+    uint32_t regmap_dirty_lo;       // written range [lo, hi) not reported yet
+    uint32_t regmap_dirty_hi;
+    bool regmap_pending;            // an I2C_SLAVE_EVT_REGMAP event is queued
+    i2c_slave_slot_t * slots;       // pre-staged responses indexed by the first command byte
+    uint8_t * slots_buf;            // two buffers of slot_max_len bytes per slot
+    uint32_t slot_count;
+    uint32_t slot_max_len;
 } i2c_slave_struct_t;
 
-typedef union {
-    struct {
-        uint32_t event : 2;
-        uint32_t stop : 1;
-        uint32_t param : 29;
+typedef struct {
+    i2c_slave_struct_t * i2c;
+    int flags;
+    esp_err_t ret;
+} i2c_slave_intr_args_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t event : 3;
+            uint32_t stop : 1;
+            uint32_t pec : 2;       // i2c_slave_pec_status_t of a master write
+            uint32_t param : 26;
+        };
+        uint32_t val;
     };
-    uint32_t val;
+    uint32_t time_us; // low bits of esp_timer_get_time() when the ISR saw the event
 } i2c_slave_queue_event_t;
+_Static_assert(sizeof(i2c_slave_queue_event_t) == 8, "I2C_SLAVE_STATIC_MEM_SIZE assumes 8 byte events");
 
 static i2c_slave_struct_t _i2c_bus_array[SOC_I2C_NUM] = {
-    { &I2C0, 0, -1, -1, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0
-#if !CONFIG_DISABLE_HAL_LOCKS
-    , NULL
-#endif
-    },
+    { .dev = &I2C0, .num = 0, .tag = "i2c_slave0", .sda = -1, .scl = -1, .spinlock = portMUX_INITIALIZER_UNLOCKED },
 #if SOC_I2C_NUM > 1
-    { &I2C1, 1, -1, -1, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0
-#if !CONFIG_DISABLE_HAL_LOCKS
-    , NULL
-#endif
-    }
+    { .dev = &I2C1, .num = 1, .tag = "i2c_slave1", .sda = -1, .scl = -1, .spinlock = portMUX_INITIALIZER_UNLOCKED },
 #endif
 };
 
@@ -139,69 +200,6 @@ static i2c_slave_struct_t _i2c_bus_array[SOC_I2C_NUM] = {
 #define I2C_SLAVE_MUTEX_UNLOCK()  if(i2c->lock){xSemaphoreGive(i2c->lock);}
 #endif
 
-//-------------------------------------- HAL_LL (Missing Functions) ------------------------------------------------
-typedef enum {
-    I2C_STRETCH_CAUSE_MASTER_READ,
-    I2C_STRETCH_CAUSE_TX_FIFO_EMPTY,
-    I2C_STRETCH_CAUSE_RX_FIFO_FULL,
-    I2C_STRETCH_CAUSE_MAX
-} i2c_stretch_cause_t;
-
-static inline i2c_stretch_cause_t i2c_ll_stretch_cause(i2c_dev_t *hw)
-{
-#if CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32S3
-    return hw->sr.stretch_cause;
-#elif CONFIG_IDF_TARGET_ESP32S2
-    return hw->status_reg.stretch_cause;
-#else
-    return I2C_STRETCH_CAUSE_MAX;
-#endif
-}
-
-static inline void i2c_ll_set_stretch(i2c_dev_t *hw, uint16_t time)
-{
-#ifndef CONFIG_IDF_TARGET_ESP32
-    typeof(hw->scl_stretch_conf) scl_stretch_conf;
-    scl_stretch_conf.val = 0;
-    scl_stretch_conf.slave_scl_stretch_en = (time > 0);
-    scl_stretch_conf.stretch_protect_num = time;
-    scl_stretch_conf.slave_scl_stretch_clr = 1;
-    hw->scl_stretch_conf.val = scl_stretch_conf.val;
-    if(time > 0){
-        //enable interrupt
-        hw->int_ena.val |= I2C_SLAVE_STRETCH_INT_ENA;
-    } else {
-        //disable interrupt
-        hw->int_ena.val &= (~I2C_SLAVE_STRETCH_INT_ENA);
-    }
-#endif
-}
-
-static inline void i2c_ll_stretch_clr(i2c_dev_t *hw)
-{
-#ifndef CONFIG_IDF_TARGET_ESP32
-    hw->scl_stretch_conf.slave_scl_stretch_clr = 1;
-#endif
-}
-
-static inline bool i2c_ll_slave_addressed(i2c_dev_t *hw)
-{
-#if CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32C6 || CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32H2
-    return hw->sr.slave_addressed;
-#else
-    return hw->status_reg.slave_addressed;
-#endif
-}
-
-static inline bool i2c_ll_slave_rw(i2c_dev_t *hw)//not exposed by hal_ll
-{
-#if CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32C6 || CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32H2
-    return hw->sr.slave_rw;
-#else
-    return hw->status_reg.slave_rw;
-#endif
-}
-
 //-------------------------------------- PRIVATE (Function Prototypes) ------------------------------------------------
 static void i2c_slave_free_resources(i2c_slave_struct_t * i2c);
 static void i2c_slave_delay_us(uint64_t us);
@@ -210,12 +208,35 @@ static bool i2c_slave_check_line_state(int8_t sda, int8_t scl);
 static bool i2c_slave_attach_gpio(i2c_slave_struct_t * i2c, int8_t sda, int8_t scl);
 static bool i2c_slave_detach_gpio(i2c_slave_struct_t * i2c);
 static bool i2c_slave_set_frequency(i2c_slave_struct_t * i2c, uint32_t clk_speed);
+static void * i2c_slave_mem_alloc(i2c_slave_struct_t * i2c, size_t size);
+static void i2c_slave_mem_free(i2c_slave_struct_t * i2c, void * ptr);
+static void i2c_slave_intr_alloc(void * arg);
 static bool i2c_slave_send_event(i2c_slave_struct_t * i2c, i2c_slave_queue_event_t* event);
+static uint32_t i2c_slave_fill_tx(i2c_slave_struct_t * i2c, const uint8_t *buf, uint32_t len);
 static bool i2c_slave_handle_tx_fifo_empty(i2c_slave_struct_t * i2c);
+static void i2c_slave_write_prepare(i2c_slave_struct_t * i2c);
+static void i2c_slave_tx_flush(i2c_slave_struct_t * i2c);
+static void i2c_slave_tx_drain(i2c_slave_struct_t * i2c);
+static bool i2c_slave_tx_staging_owner(i2c_slave_struct_t * i2c);
+static void i2c_slave_tx_loaded(i2c_slave_struct_t * i2c, const uint8_t * buf, uint32_t n);
+static void i2c_slave_tx_publish(i2c_slave_struct_t * i2c);
+static void i2c_slave_regmap_rx(i2c_slave_struct_t * i2c, const uint8_t * data, uint32_t len);
+static void i2c_slave_regmap_tx(i2c_slave_struct_t * i2c);
+static bool i2c_slave_isr_answer(i2c_slave_struct_t * i2c);
 static bool i2c_slave_handle_rx_fifo_full(i2c_slave_struct_t * i2c, uint32_t len);
 static size_t i2c_slave_read_rx(i2c_slave_struct_t * i2c, uint8_t * data, size_t len);
+static uint8_t * i2c_slave_pool_get(i2c_slave_struct_t * i2c);
+static void i2c_slave_pool_put(i2c_slave_struct_t * i2c, uint8_t * buf);
+static uint8_t * i2c_slave_take_rx(i2c_slave_struct_t * i2c, size_t * len, void ** item);
+static void i2c_slave_return_rx(i2c_slave_struct_t * i2c, uint8_t * data, size_t len, void * item);
+static bool i2c_slave_service(i2c_slave_struct_t * i2c);
 static void i2c_slave_isr_handler(void* arg);
+static void i2c_slave_trans_info(const i2c_slave_queue_event_t * event, i2c_slave_trans_info_t * info);
+static void i2c_slave_dispatch_event(i2c_slave_struct_t * i2c, const i2c_slave_queue_event_t * event);
+static bool i2c_slave_next_event(i2c_slave_struct_t * i2c, i2c_slave_queue_event_t * event, TickType_t ticks);
+static void i2c_slave_tx_stream_fill(i2c_slave_struct_t * i2c);
 static void i2c_slave_task(void *pv_args);
+static void i2c_slave_poll_task(void *pv_args);
 
 //=====================================================================================================================
 //-------------------------------------- Public Functions -------------------------------------------------------------
@@ -230,12 +251,283 @@ esp_err_t i2cSlaveAttachCallbacks(uint8_t num, i2c_slave_request_cb_t request_ca
     I2C_SLAVE_MUTEX_LOCK();
     i2c->request_callback = request_callback;
     i2c->receive_callback = receive_callback;
+    i2c->request_callback_ex = NULL;
+    i2c->receive_callback_ex = NULL;
+    i2c->arg = arg;
+    I2C_SLAVE_MUTEX_UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveAttachCallbacksEx(uint8_t num, i2c_slave_request_ex_cb_t request_callback, i2c_slave_receive_ex_cb_t receive_callback, void * arg){
+    if(num >= SOC_I2C_NUM){
+        ESP_LOGE(TAG, "Invalid port num: %u", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    I2C_SLAVE_MUTEX_LOCK();
+    i2c->request_callback = NULL;
+    i2c->receive_callback = NULL;
+    i2c->request_callback_ex = request_callback;
+    i2c->receive_callback_ex = receive_callback;
     i2c->arg = arg;
     I2C_SLAVE_MUTEX_UNLOCK();
     return ESP_OK;
 }
 
+esp_err_t i2cSlaveAttachIsrRequestCallback(uint8_t num, i2c_slave_isr_request_cb_t isr_request_callback, void * arg){
+    if(num >= SOC_I2C_NUM){
+        ESP_LOGE(TAG, "Invalid port num: %u", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    I2C_SLAVE_MUTEX_LOCK();
+    i2c->isr_request_callback = NULL;
+    i2c->isr_arg = arg;
+    i2c->isr_request_callback = isr_request_callback;
+    I2C_SLAVE_MUTEX_UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveAttachRegisterMap(uint8_t num, uint8_t * regs, size_t size, i2c_slave_regmap_cb_t changed_callback, void * arg){
+    if(num >= SOC_I2C_NUM || (regs && (size == 0 || size > 256))){
+        ESP_LOGE(TAG, "Invalid port num: %u or register map size: %u", num, size);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "Register map must be attached before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->regmap = regs;
+    i2c->regmap_size = regs ? size : 0;
+    i2c->regmap_callback = changed_callback;
+    i2c->regmap_arg = arg;
+    i2c->regmap_ptr = 0;
+    i2c->regmap_ptr_next = true;
+    i2c->regmap_dirty_lo = i2c->regmap_size;
+    i2c->regmap_dirty_hi = 0;
+    i2c->regmap_pending = false;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveRegisterMapWrite(uint8_t num, size_t offset, const uint8_t * data, size_t len){
+    if(num >= SOC_I2C_NUM || !_i2c_bus_array[num].regmap || offset + len > _i2c_bus_array[num].regmap_size){
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    portENTER_CRITICAL(&i2c->spinlock);
+    memcpy(i2c->regmap + offset, data, len);
+    portEXIT_CRITICAL(&i2c->spinlock);
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveRegisterMapRead(uint8_t num, size_t offset, uint8_t * data, size_t len){
+    if(num >= SOC_I2C_NUM || !_i2c_bus_array[num].regmap || offset + len > _i2c_bus_array[num].regmap_size){
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    portENTER_CRITICAL(&i2c->spinlock);
+    memcpy(data, i2c->regmap + offset, len);
+    portEXIT_CRITICAL(&i2c->spinlock);
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveSetResponseSlots(uint8_t num, size_t count, size_t max_len){
+    if(num >= SOC_I2C_NUM || count > 256 || max_len > UINT16_MAX){
+        ESP_LOGE(TAG, "Invalid port num: %u or response slots: %u x %u", num, count, max_len);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "Response slots must be set before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->slot_count = (max_len) ? count : 0;
+    i2c->slot_max_len = max_len;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlavePublishResponse(uint8_t num, uint8_t cmd, const uint8_t * data, size_t len){
+    if(num >= SOC_I2C_NUM){
+        ESP_LOGE(TAG, "Invalid port num: %u", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(!i2c->slots || cmd >= i2c->slot_count || len > i2c->slot_max_len || (len && !data)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(i2c_slave_tx_staging_owner(i2c)){
+        //the port lock is already held by this task's i2cSlaveWriteBegin
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c_slave_slot_t * slot = &i2c->slots[cmd];
+    I2C_SLAVE_MUTEX_LOCK();
+    uint32_t back = !(__atomic_load_n(&slot->ctrl, __ATOMIC_ACQUIRE) & I2C_SLAVE_SLOT_FRONT);
+    //the back buffer may still be read by an ISR that started before the last swap,
+    //wait for it on the other core, the ISR itself never waits
+    while(__atomic_load_n(&slot->ctrl, __ATOMIC_ACQUIRE) & I2C_SLAVE_SLOT_BUSY);
+    memcpy(i2c->slots_buf + (cmd * 2 + back) * i2c->slot_max_len, data, len);
+    slot->len[back] = len;
+    if(back){
+        __atomic_fetch_or(&slot->ctrl, I2C_SLAVE_SLOT_FRONT, __ATOMIC_RELEASE);
+    } else {
+        __atomic_fetch_and(&slot->ctrl, ~I2C_SLAVE_SLOT_FRONT, __ATOMIC_RELEASE);
+    }
+    I2C_SLAVE_MUTEX_UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveAttachTxProducer(uint8_t num, i2c_slave_tx_producer_cb_t producer, size_t low_water, void * arg){
+    if(num >= SOC_I2C_NUM){
+        ESP_LOGE(TAG, "Invalid port num: %u", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "TX producer must be attached before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->tx_producer = producer;
+    i2c->tx_producer_arg = arg;
+    i2c->tx_low_water = low_water;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveAttachRxChunkCallback(uint8_t num, i2c_slave_rx_chunk_cb_t chunk_callback, size_t chunk_len, void * arg){
+    if(num >= SOC_I2C_NUM || (chunk_callback && chunk_len == 0)){
+        ESP_LOGE(TAG, "Invalid port num: %u or chunk length: %u", num, chunk_len);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "RX chunk callback must be attached before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->rx_chunk_callback = chunk_callback;
+    i2c->rx_chunk_arg = arg;
+    i2c->rx_chunk_len = chunk_callback ? chunk_len : 0;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveSetFifoThresholds(uint8_t num, uint8_t rx_full_thr, uint8_t tx_empty_thr, bool adaptive){
+    if(num >= SOC_I2C_NUM || rx_full_thr >= SOC_I2C_FIFO_LEN || tx_empty_thr >= SOC_I2C_FIFO_LEN){
+        ESP_LOGE(TAG, "Invalid port num: %u or FIFO thresholds: %u, %u", num, rx_full_thr, tx_empty_thr);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "FIFO thresholds must be set before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->rx_fifo_thr_cfg = rx_full_thr;
+    i2c->tx_fifo_thr_cfg = tx_empty_thr;
+    i2c->fifo_thr_adaptive = adaptive;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveGetFifoThresholds(uint8_t num, uint8_t * rx_full_thr, uint8_t * tx_empty_thr){
+    if(num >= SOC_I2C_NUM || rx_full_thr == NULL || tx_empty_thr == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    *rx_full_thr = _i2c_bus_array[num].rx_fifo_thr;
+    *tx_empty_thr = _i2c_bus_array[num].tx_fifo_thr;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveSetPec(uint8_t num, bool enable){
+    if(num >= SOC_I2C_NUM){
+        ESP_LOGE(TAG, "Invalid port num: %u", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "PEC must be set before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->pec_enabled = enable;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveSetRxDelivery(uint8_t num, i2c_slave_rx_delivery_t delivery){
+    if(num >= SOC_I2C_NUM){
+        ESP_LOGE(TAG, "Invalid port num: %u", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "RX delivery must be set before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->rx_delivery = delivery;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveSetRxMode(uint8_t num, i2c_slave_rx_mode_t mode){
+    if(num >= SOC_I2C_NUM || mode > I2C_SLAVE_RX_RING){
+        ESP_LOGE(TAG, "Invalid port num: %u or RX mode: %d", num, mode);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "RX mode must be set before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->rx_mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveSetEventDelivery(uint8_t num, i2c_slave_event_mode_t mode, size_t depth){
+    if(num >= SOC_I2C_NUM || mode > I2C_SLAVE_EVENT_NOTIFY){
+        ESP_LOGE(TAG, "Invalid port num: %u or event mode: %d", num, mode);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(i2c->tx_ring.buf){
+        ESP_LOGE(i2c->tag, "Event delivery must be set before i2cSlaveInit");
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c->event_mode = mode;
+    i2c->event_depth = depth;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveGetStats(uint8_t num, i2c_slave_stats_t * stats){
+    if(num >= SOC_I2C_NUM || stats == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    //best effort, the ISR does not take a lock around its updates either
+    *stats = _i2c_bus_array[num].stats;
+    return ESP_OK;
+}
+
+esp_err_t i2cSlaveResetStats(uint8_t num){
+    if(num >= SOC_I2C_NUM){
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    portENTER_CRITICAL(&i2c->spinlock);
+    memset(&i2c->stats, 0, sizeof(i2c_slave_stats_t));
+    portEXIT_CRITICAL(&i2c->spinlock);
+    return ESP_OK;
+}
+
+uint32_t i2cSlaveGetDropCount(uint8_t num){
+    if(num >= SOC_I2C_NUM){
+        ESP_LOGE(TAG, "Invalid port num: %u", num);
+        return 0;
+    }
+    return _i2c_bus_array[num].stats.pool_drops;
+}
+
 esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t frequency, size_t rx_len, size_t tx_len) {
+    i2c_slave_config_t config = I2C_SLAVE_CONFIG_DEFAULT(sda, scl, slaveID);
+    config.frequency = frequency;
+    config.rx_len = rx_len;
+    config.tx_len = tx_len;
+    return i2cSlaveInitEx(num, &config);
+}
+
+esp_err_t i2cSlaveInitEx(uint8_t num, const i2c_slave_config_t * config) {
 
 #ifdef DEBUG_MODE
     gpio_config_t conf = {
@@ -250,13 +542,56 @@ esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t
     gpio_set_level(DEBUG_IO2, 0);
 #endif
 
-    if(num >= SOC_I2C_NUM){
-        ESP_LOGE(TAG, "Invalid port num: %u", num);
+    if(num >= SOC_I2C_NUM || config == NULL){
+        ESP_LOGE(TAG, "Invalid port num: %u or config", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+
+    int sda = config->sda;
+    int scl = config->scl;
+    uint16_t slaveID = config->slave_addr;
+    uint32_t frequency = config->frequency;
+    size_t rx_len = config->rx_len;
+    size_t tx_len = config->tx_len;
+
+    if (config->task_core < -1 || config->task_core >= portNUM_PROCESSORS
+        || config->intr_core < -1 || config->intr_core >= portNUM_PROCESSORS) {
+        ESP_LOGE(i2c->tag, "invalid cores task=%d, intr=%d", config->task_core, config->intr_core);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->static_mem && ((uintptr_t)config->static_mem & 15)) {
+        ESP_LOGE(i2c->tag, "static_mem must be 16 byte aligned");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#if !CONFIG_I2C_SLAVE_ISR_IN_IRAM
+    if (config->intr_iram) {
+        ESP_LOGE(i2c->tag, "IRAM interrupt needs CONFIG_I2C_SLAVE_ISR_IN_IRAM");
+        return ESP_ERR_INVALID_ARG;
+    }
+#endif
+
+    if (config->polled && config->worker_disabled) {
+        ESP_LOGE(i2c->tag, "polled mode needs the worker task");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->polled && config->task_core < 0) {
+        //the poll task never blocks, left unpinned it would starve whichever core it lands on
+        ESP_LOGE(i2c->tag, "polled mode needs task_core");
         return ESP_ERR_INVALID_ARG;
     }
 
     if (sda < 0 || scl < 0) {
-        ESP_LOGE(TAG, "invalid pins sda=%d, scl=%d", sda, scl);
+        ESP_LOGE(i2c->tag, "invalid pins sda=%d, scl=%d", sda, scl);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (_i2c_bus_array[num].rx_chunk_len + SOC_I2C_FIFO_LEN > rx_len && _i2c_bus_array[num].rx_chunk_len) {
+        //a chunk is handed over at the first RX FIFO read past rx_chunk_len
+        ESP_LOGE(i2c->tag, "rx_len must be at least the RX chunk length + %d", SOC_I2C_FIFO_LEN);
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -266,16 +601,15 @@ esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t
         frequency = 1000000;
     }
 
-    ESP_LOGI(TAG, "Initialising I2C Slave: sda=%d scl=%d freq=%" PRIu32 ", addr=0x%x", sda, scl, frequency, slaveID);
+    ESP_LOGI(i2c->tag, "Initialising I2C Slave: sda=%d scl=%d freq=%" PRIu32 ", addr=0x%x", sda, scl, frequency, slaveID);
 
-    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
     esp_err_t ret = ESP_OK;
 
 #if !CONFIG_DISABLE_HAL_LOCKS
     if(!i2c->lock){
         i2c->lock = xSemaphoreCreateMutex();
         if (i2c->lock == NULL) {
-            ESP_LOGE(TAG, "RX queue create failed");
+            ESP_LOGE(i2c->tag, "RX queue create failed");
             return ESP_ERR_NO_MEM;
         }
     }
@@ -283,42 +617,129 @@ esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t
 
     I2C_SLAVE_MUTEX_LOCK();
     i2c_slave_free_resources(i2c);
+    i2c->static_mem = (uint8_t*)config->static_mem;
+    i2c->static_left = config->static_mem ? config->static_mem_size : 0;
+    i2c->polled = config->polled;
+    i2c->worker_disabled = config->worker_disabled;
+
+    if(i2c->rx_mode == I2C_SLAVE_RX_QUEUE){
+        if(i2c->static_mem){
+            uint8_t * rx_buf = (uint8_t*)i2c_slave_mem_alloc(i2c, rx_len);
+            if(rx_buf){
+                i2c->rx_queue = xQueueCreateStatic(rx_len, sizeof(uint8_t), rx_buf, &i2c->rx_queue_static);
+            }
+        } else {
+            i2c->rx_queue = xQueueCreate(rx_len, sizeof(uint8_t));
+        }
+        if (i2c->rx_queue == NULL) {
+            ESP_LOGE(i2c->tag, "RX queue create failed");
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+    } else if(i2c->rx_mode == I2C_SLAVE_RX_RING){
+        uint8_t * rx_buf = (uint8_t*)i2c_slave_mem_alloc(i2c, rx_len + 1);
+        if (rx_buf == NULL) {
+            ESP_LOGE(i2c->tag, "RX ring create failed");
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+        i2c_slave_ring_init(&i2c->rx_ring, rx_buf, rx_len + 1);
+    } else {
+        if(i2c->static_mem){
+            uint8_t * rx_buf = (uint8_t*)i2c_slave_mem_alloc(i2c, rx_len);
+            if(rx_buf){
+                i2c->rx_ring_buf = xRingbufferCreateStatic(rx_len, RINGBUF_TYPE_BYTEBUF, rx_buf, &i2c->rx_ring_buf_static);
+            }
+        } else {
+            i2c->rx_ring_buf = xRingbufferCreate(rx_len, RINGBUF_TYPE_BYTEBUF);
+        }
+        if (i2c->rx_ring_buf == NULL) {
+            ESP_LOGE(i2c->tag, "RX RingBuf create failed");
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+    }
 
-#if I2C_SLAVE_USE_RX_QUEUE
-    i2c->rx_queue = xQueueCreate(rx_len, sizeof(uint8_t));
-    if (i2c->rx_queue == NULL) {
-        ESP_LOGE(TAG, "RX queue create failed");
+    i2c->pool = (uint8_t*)i2c_slave_mem_alloc(i2c, CONFIG_I2C_SLAVE_POOL_BUFFERS * rx_len);
+    if (i2c->pool == NULL) {
+        ESP_LOGE(i2c->tag, "Transaction pool alloc failed");
         ret = ESP_ERR_NO_MEM;
         goto fail;
     }
-#else
-    i2c->rx_ring_buf = xRingbufferCreate(rx_len, RINGBUF_TYPE_BYTEBUF);
-    if (i2c->rx_ring_buf == NULL) {
-        ESP_LOGE(TAG, "RX RingBuf create failed");
-        ret = ESP_ERR_NO_MEM;
-        goto fail;
+    i2c->pool_buf_len = rx_len;
+    i2c->pool_free = (1UL << CONFIG_I2C_SLAVE_POOL_BUFFERS) - 1;
+
+    if(i2c->slot_count){
+        i2c->slots = (i2c_slave_slot_t*)i2c_slave_mem_alloc(i2c, i2c->slot_count * sizeof(i2c_slave_slot_t));
+        i2c->slots_buf = (uint8_t*)i2c_slave_mem_alloc(i2c, i2c->slot_count * 2 * i2c->slot_max_len);
+        if (i2c->slots == NULL || i2c->slots_buf == NULL) {
+            ESP_LOGE(i2c->tag, "Response slots alloc failed");
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+        memset(i2c->slots, 0, i2c->slot_count * sizeof(i2c_slave_slot_t));
     }
-#endif
 
-    i2c->tx_queue = xQueueCreate(tx_len, sizeof(uint8_t));
-    if (i2c->tx_queue == NULL) {
-        ESP_LOGE(TAG, "TX queue create failed");
+    uint8_t * tx_buf = (uint8_t*)i2c_slave_mem_alloc(i2c, tx_len + 1);
+    if (tx_buf == NULL) {
+        ESP_LOGE(i2c->tag, "TX ring create failed");
         ret = ESP_ERR_NO_MEM;
         goto fail;
     }
+    i2c_slave_ring_init(&i2c->tx_ring, tx_buf, tx_len + 1);
+    if(i2c->tx_producer && (i2c->tx_low_water == 0 || i2c->tx_low_water > tx_len)){
+        i2c->tx_low_water = tx_len / 2;
+    }
 
-    i2c->event_queue = xQueueCreate(16, sizeof(i2c_slave_queue_event_t));
-    if (i2c->event_queue == NULL) {
-        ESP_LOGE(TAG, "Event queue create failed");
-        ret = ESP_ERR_NO_MEM;
-        goto fail;
+    size_t event_depth = i2c->event_depth ? i2c->event_depth : I2C_SLAVE_EVENT_DEPTH_DEFAULT;
+    if(i2c->polled){
+        //events are dispatched inline by the poll task
+    } else if(i2c->event_mode == I2C_SLAVE_EVENT_NOTIFY){
+        uint8_t * event_buf = (uint8_t*)i2c_slave_mem_alloc(i2c, event_depth * sizeof(i2c_slave_queue_event_t) + 1);
+        if (event_buf == NULL) {
+            ESP_LOGE(i2c->tag, "Event ring create failed");
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+        i2c_slave_ring_init(&i2c->event_ring, event_buf, event_depth * sizeof(i2c_slave_queue_event_t) + 1);
+    } else {
+        if(i2c->static_mem){
+            uint8_t * event_buf = (uint8_t*)i2c_slave_mem_alloc(i2c, event_depth * sizeof(i2c_slave_queue_event_t));
+            if(event_buf){
+                i2c->event_queue = xQueueCreateStatic(event_depth, sizeof(i2c_slave_queue_event_t), event_buf, &i2c->event_queue_static);
+            }
+        } else {
+            i2c->event_queue = xQueueCreate(event_depth, sizeof(i2c_slave_queue_event_t));
+        }
+        if (i2c->event_queue == NULL) {
+            ESP_LOGE(i2c->tag, "Event queue create failed");
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
     }
 
-    xTaskCreate(i2c_slave_task, "i2c_slave_task", 4096, i2c, 20, &i2c->task_handle);
-    if(i2c->task_handle == NULL){
-        ESP_LOGE(TAG, "Event thread create failed");
-        ret = ESP_ERR_NO_MEM;
-        goto fail;
+    if(!i2c->worker_disabled){
+        BaseType_t task_core = (config->task_core < 0) ? tskNO_AFFINITY : config->task_core;
+        TaskFunction_t task_func = i2c->polled ? i2c_slave_poll_task : i2c_slave_task;
+        if(i2c->static_mem){
+            StackType_t * stack = (StackType_t*)i2c_slave_mem_alloc(i2c, config->task_stack_size);
+            if(stack){
+                i2c->task_handle = xTaskCreateStaticPinnedToCore(task_func, i2c->tag, config->task_stack_size, i2c,
+                                                                 config->task_priority, stack, &i2c->task_static, task_core);
+            }
+        } else {
+            xTaskCreatePinnedToCore(task_func, i2c->tag, config->task_stack_size, i2c, config->task_priority, &i2c->task_handle, task_core);
+        }
+        if(i2c->task_handle == NULL){
+            ESP_LOGE(i2c->tag, "Event thread create failed");
+            ret = ESP_ERR_NO_MEM;
+            goto fail;
+        }
+        i2c->event_task = i2c->task_handle;
+        if(i2c->polled){
+            i2c->poll_core = config->task_core;
+            i2c->idle_wdt_removed = i2c_slave_hal_idle_wdt_remove(config->task_core);
+        }
     }
 
     if (frequency == 0) {
@@ -326,21 +747,16 @@ esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t
     }
     frequency = (frequency * 5) / 4;
 
-    if (i2c->num == 0) {
-        periph_ll_enable_clk_clear_rst(PERIPH_I2C0_MODULE);
-#if SOC_I2C_NUM > 1
-    } else {
-        periph_ll_enable_clk_clear_rst(PERIPH_I2C1_MODULE);
-#endif
-    }
-    
+    i2c_slave_hal_enable_periph(i2c->num);
+
     i2c_ll_slave_init(i2c->dev);
+    i2c->slave_addr = slaveID;
     i2c_ll_set_slave_addr(i2c->dev, slaveID, false);
     i2c_ll_set_tout(i2c->dev, I2C_LL_MAX_TIMEOUT);
     i2c_slave_set_frequency(i2c, frequency);
 
     if (!i2c_slave_check_line_state(sda, scl)) {
-        ESP_LOGE(TAG, "bad pin state");
+        ESP_LOGE(i2c->tag, "bad pin state");
         ret = ESP_FAIL;
         goto fail;
     }
@@ -348,7 +764,7 @@ esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t
     i2c_slave_attach_gpio(i2c, sda, scl);
 
     if (i2c_ll_is_bus_busy(i2c->dev)) {
-        ESP_LOGW(TAG, "Bus busy, reinit");
+        ESP_LOGW(i2c->tag, "Bus busy, reinit");
         ret = ESP_FAIL;
         goto fail;
     }
@@ -357,18 +773,27 @@ esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t
     i2c_ll_clr_intsts_mask(i2c->dev, I2C_LL_INTR_MASK);
     i2c_ll_set_fifo_mode(i2c->dev, true);
 
-    if (!i2c->intr_handle) {
-        uint32_t flags = ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_SHARED;
-        if(i2c->num == 0) {
-            ret = esp_intr_alloc(ETS_I2C_EXT0_INTR_SOURCE, flags, &i2c_slave_isr_handler, i2c, &i2c->intr_handle);
-#if SOC_I2C_NUM > 1
-        } else {
-            ret = esp_intr_alloc(ETS_I2C_EXT1_INTR_SOURCE, flags, &i2c_slave_isr_handler, i2c, &i2c->intr_handle);
+    if (!i2c->intr_handle && !i2c->polled) {
+        i2c_slave_intr_args_t intr_args = {
+            .i2c = i2c,
+            .flags = ESP_INTR_FLAG_LOWMED | (config->intr_iram ? ESP_INTR_FLAG_IRAM : (config->intr_shared ? ESP_INTR_FLAG_SHARED : 0)),
+            .ret = ESP_OK,
+        };
+#if I2C_SLAVE_HAL_MULTICORE
+        if(config->intr_core >= 0 && config->intr_core != xPortGetCoreID()){
+            //interrupts are bound to the core that allocates them
+            ret = esp_ipc_call_blocking(config->intr_core, i2c_slave_intr_alloc, &intr_args);
+        } else
 #endif
+        {
+            i2c_slave_intr_alloc(&intr_args);
+        }
+        if (ret == ESP_OK) {
+            ret = intr_args.ret;
         }
 
         if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "install interrupt handler Failed=%d", ret);
+            ESP_LOGE(i2c->tag, "install interrupt handler Failed=%d", ret);
             goto fail;
         }
     }
@@ -378,6 +803,10 @@ esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t
     i2c_ll_slave_enable_rx_it(i2c->dev);
     i2c_ll_set_stretch(i2c->dev, 0x3FF);
     i2c_ll_update(i2c->dev);
+    if(i2c->polled){
+        //the peripheral is ready, start polling
+        xTaskNotifyGive(i2c->task_handle);
+    }
     I2C_SLAVE_MUTEX_UNLOCK();
     return ret;
 
@@ -396,7 +825,7 @@ esp_err_t i2cSlaveDeinit(uint8_t num){
     i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
 #if !CONFIG_DISABLE_HAL_LOCKS
     if(!i2c->lock){
-        ESP_LOGE(TAG, "Lock is not initialized! Did you call i2c_slave_init()?");
+        ESP_LOGE(i2c->tag, "Lock is not initialized! Did you call i2c_slave_init()?");
         return ESP_ERR_NO_MEM;
     }
 #endif
@@ -411,67 +840,214 @@ size_t i2cSlaveWrite(uint8_t num, const uint8_t *buf, uint32_t len, uint32_t tim
         ESP_LOGE(TAG, "Invalid port num: %u", num);
         return 0;
     }
-    uint32_t to_queue = 0, to_fifo = 0;
     i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
 #if !CONFIG_DISABLE_HAL_LOCKS
     if(!i2c->lock){
-        ESP_LOGE(TAG, "Lock is not initialized! Did you call i2c_slave_init()?");
+        ESP_LOGE(i2c->tag, "Lock is not initialized! Did you call i2c_slave_init()?");
         return ESP_ERR_NO_MEM;
     }
 #endif
-    if(!i2c->tx_queue){
+    if(!i2c->tx_ring.buf || i2c_slave_tx_staging_owner(i2c)){
         return 0;
     }
     I2C_SLAVE_MUTEX_LOCK();
-#if CONFIG_IDF_TARGET_ESP32
-    i2c_ll_slave_disable_tx_it(i2c->dev);
-    uint32_t txfifo_len = 0;
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-    i2c_ll_get_txfifo_len(i2c->dev, &txfifo_len);
-#else
-    txfifo_len = i2c_ll_get_txfifo_len(i2c->dev);
-#endif
-    if (txfifo_len < SOC_I2C_FIFO_LEN) {
-        i2c_ll_txfifo_rst(i2c->dev);
+    i2c_slave_write_prepare(i2c);
+    len = i2c_slave_fill_tx(i2c, buf, len);
+    I2C_SLAVE_MUTEX_UNLOCK();
+    return len;
+}
+
+size_t i2cSlaveWritev(uint8_t num, const i2c_slave_iovec_t *iov, size_t iovcnt, uint32_t timeout_ms) {
+    if(num >= SOC_I2C_NUM || (iovcnt && iov == NULL)){
+        ESP_LOGE(TAG, "Invalid port num: %u or iov", num);
+        return 0;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+#if !CONFIG_DISABLE_HAL_LOCKS
+    if(!i2c->lock){
+        ESP_LOGE(i2c->tag, "Lock is not initialized! Did you call i2c_slave_init()?");
+        return ESP_ERR_NO_MEM;
     }
 #endif
-
+    if(!i2c->tx_ring.buf || i2c_slave_tx_staging_owner(i2c)){
+        return 0;
+    }
+    I2C_SLAVE_MUTEX_LOCK();
+    i2c_slave_write_prepare(i2c);
+    uint32_t to_fifo = 0, written = 0;
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
     i2c_ll_get_txfifo_len(i2c->dev, &to_fifo);
 #else
     to_fifo = i2c_ll_get_txfifo_len(i2c->dev);
 #endif
-
+    //same as i2cSlaveWrite: nothing goes out while the FIFO is full
     if(to_fifo){
-        if(len < to_fifo){
-            to_fifo = len;
-        }
-        i2c_ll_write_txfifo(i2c->dev, (uint8_t*)buf, to_fifo);
-        buf += to_fifo;
-        len -= to_fifo;
-        //reset tx_queue
-        xQueueReset(i2c->tx_queue);
-        //write the rest of the bytes to the queue
-        if(len){
-            to_queue = uxQueueSpacesAvailable(i2c->tx_queue);
-            if(len < to_queue){
-                to_queue = len;
-            }
-            for (size_t i = 0; i < to_queue; i++) {
-                if (xQueueSend(i2c->tx_queue, &buf[i], timeout_ms / portTICK_PERIOD_MS) != pdTRUE) {
-                    xQueueReset(i2c->tx_queue);
-                    to_queue = 0;
-                    break;
+        i2c_slave_tx_flush(i2c);
+        i2c->tx_staged = 0;
+        for(size_t i = 0; i < iovcnt; i++){
+            const uint8_t * buf = (const uint8_t *)iov[i].base;
+            uint32_t len = iov[i].len;
+            uint32_t n = (len < to_fifo) ? len : to_fifo;
+            if(n){
+                //leading fragments straight into the FIFO
+                i2c_ll_write_txfifo(i2c->dev, (uint8_t*)buf, n);
+                i2c_slave_tx_loaded(i2c, buf, n);
+                if(i2c->pec_enabled){
+                    i2c->tx_pec = smbus_pec_update(i2c->tx_pec, buf, n);
                 }
+                to_fifo -= n;
+                written += n;
             }
-            //no need to enable TX_EMPTY if tx_queue is empty
-            if(to_queue){
-                i2c_ll_slave_enable_tx_it(i2c->dev);
+            if(len > n){
+                uint32_t staged = i2c_slave_ring_stage(&i2c->tx_ring, i2c->tx_staged, buf + n, len - n);
+                i2c->tx_staged += staged;
+                written += staged;
             }
         }
+        i2c_slave_tx_publish(i2c);
     }
     I2C_SLAVE_MUTEX_UNLOCK();
-    return to_queue + to_fifo;
+    return written;
+}
+
+esp_err_t i2cSlaveWriteBegin(uint8_t num) {
+    if(num >= SOC_I2C_NUM){
+        ESP_LOGE(TAG, "Invalid port num: %u", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(!i2c->tx_ring.buf || i2c_slave_tx_staging_owner(i2c)){
+        return ESP_ERR_INVALID_STATE;
+    }
+    I2C_SLAVE_MUTEX_LOCK();
+    i2c->tx_staged = 0;
+    i2c->tx_staging = true;
+    return ESP_OK;
+}
+
+size_t i2cSlaveWriteAppend(uint8_t num, const uint8_t *buf, size_t len) {
+    if(num >= SOC_I2C_NUM || (len && buf == NULL) || !i2c_slave_tx_staging_owner(&_i2c_bus_array[num])){
+        return 0;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    uint32_t staged = i2c_slave_ring_stage(&i2c->tx_ring, i2c->tx_staged, buf, len);
+    i2c->tx_staged += staged;
+    return staged;
+}
+
+size_t i2cSlaveWriteCommit(uint8_t num) {
+    if(num >= SOC_I2C_NUM || !i2c_slave_tx_staging_owner(&_i2c_bus_array[num])){
+        return 0;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    size_t len = i2c->tx_staged;
+    i2c_slave_write_prepare(i2c);
+    //replace what is still pending, then preload the FIFO like i2cSlaveWritev, the watermark interrupt only tops it up
+    i2c_slave_tx_flush(i2c);
+    i2c_slave_tx_publish(i2c);
+    i2c_slave_tx_drain(i2c);
+    i2c->tx_staging = false;
+    I2C_SLAVE_MUTEX_UNLOCK();
+    return len;
+}
+
+esp_err_t i2cSlaveWriteAbort(uint8_t num) {
+    if(num >= SOC_I2C_NUM || !i2c_slave_tx_staging_owner(&_i2c_bus_array[num])){
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    i2c->tx_staged = 0;
+    i2c->tx_staging = false;
+    I2C_SLAVE_MUTEX_UNLOCK();
+    return ESP_OK;
+}
+
+size_t I2C_SLAVE_ISR_ATTR i2cSlaveWriteFromISR(uint8_t num, const uint8_t *buf, uint32_t len) {
+    if(num >= SOC_I2C_NUM || !_i2c_bus_array[num].tx_ring.buf){
+        return 0;
+    }
+    return i2c_slave_fill_tx(&_i2c_bus_array[num], buf, len);
+}
+
+esp_err_t i2cSlaveReadAcquire(uint8_t num, i2c_slave_read_t * rd, uint32_t timeout_ms) {
+    if(num >= SOC_I2C_NUM || rd == NULL){
+        ESP_LOGE(TAG, "Invalid port num: %u or read", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(!i2c->worker_disabled || !i2c->tx_ring.buf || i2c->read_held){
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c_slave_queue_event_t event;
+    TimeOut_t timeout;
+    TickType_t ticks = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    vTaskSetTimeOutState(&timeout);
+    for(bool first = true;; first = false){
+        //master reads and refills handled below count against the timeout too, the first pass always
+        //looks once so that a timeout of 0 polls
+        if(!first && xTaskCheckForTimeOut(&timeout, &ticks) == pdTRUE){
+            return ESP_ERR_TIMEOUT;
+        }
+        if(!i2c_slave_next_event(i2c, &event, ticks)){
+            continue;
+        }
+        if(event.event != I2C_SLAVE_EVT_RX && event.event != I2C_SLAVE_EVT_RX_CHUNK){
+            //master reads, refills and register map updates run here, as they would in the worker
+            i2c_slave_dispatch_event(i2c, &event);
+            continue;
+        }
+        size_t len = event.param;
+        void * item = NULL;
+        uint8_t * data = i2c_slave_take_rx(i2c, &len, &item);
+        if(!data && event.param){
+            //dropped, no pool buffer was free
+            continue;
+        }
+        i2c_slave_trans_info(&event, &rd->info);
+        rd->data = data;
+        //hide the PEC byte, like the callbacks
+        rd->len = (rd->info.pec != I2C_SLAVE_PEC_NONE && len) ? len - 1 : len;
+        rd->offset = i2c->rx_stream_offset;
+        rd->stop = event.stop;
+        rd->end = (event.event == I2C_SLAVE_EVT_RX);
+        rd->priv_item = item;
+        rd->priv_len = len;
+        i2c->rx_stream_offset = rd->end ? 0 : (i2c->rx_stream_offset + len);
+        i2c->read_held = true;
+        return ESP_OK;
+    }
+}
+
+esp_err_t i2cSlaveReadRelease(uint8_t num, i2c_slave_read_t * rd) {
+    if(num >= SOC_I2C_NUM || rd == NULL){
+        ESP_LOGE(TAG, "Invalid port num: %u or read", num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_slave_struct_t * i2c = &_i2c_bus_array[num];
+    if(!i2c->read_held){
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c_slave_return_rx(i2c, (uint8_t *)rd->data, rd->priv_len, rd->priv_item);
+    i2c->read_held = false;
+    return ESP_OK;
+}
+
+size_t i2cSlaveRead(uint8_t num, uint8_t * buf, size_t len, bool * stop, uint32_t timeout_ms) {
+    i2c_slave_read_t rd;
+    if((len && buf == NULL) || i2cSlaveReadAcquire(num, &rd, timeout_ms) != ESP_OK){
+        return 0;
+    }
+    if(len > rd.len){
+        len = rd.len;
+    }
+    if(len){
+        memcpy(buf, rd.data, len);
+    }
+    if(stop){
+        *stop = rd.stop;
+    }
+    i2cSlaveReadRelease(num, &rd);
+    return len;
 }
 
 //=====================================================================================================================
@@ -493,30 +1069,91 @@ static void i2c_slave_free_resources(i2c_slave_struct_t * i2c){
         vTaskDelete(i2c->task_handle);
         i2c->task_handle = NULL;
     }
+    if(i2c->idle_wdt_removed){
+        i2c_slave_hal_idle_wdt_restore(i2c->poll_core);
+        i2c->idle_wdt_removed = false;
+    }
+    i2c->event_task = NULL;
+    i2c->read_held = false;
 
-#if I2C_SLAVE_USE_RX_QUEUE
     if (i2c->rx_queue) {
         vQueueDelete(i2c->rx_queue);
         i2c->rx_queue = NULL;
     }
-#else
+
     if (i2c->rx_ring_buf) {
         vRingbufferDelete(i2c->rx_ring_buf);
         i2c->rx_ring_buf = NULL;
     }
-#endif
 
-    if (i2c->tx_queue) {
-        vQueueDelete(i2c->tx_queue);
-        i2c->tx_queue = NULL;
-    }
+    i2c_slave_mem_free(i2c, i2c->rx_ring.buf);
+    i2c_slave_ring_init(&i2c->rx_ring, NULL, 0);
+
+    i2c_slave_mem_free(i2c, i2c->pool);
+    i2c->pool = NULL;
+    i2c_slave_mem_free(i2c, i2c->slots);
+    i2c->slots = NULL;
+    i2c_slave_mem_free(i2c, i2c->slots_buf);
+    i2c->slots_buf = NULL;
+    i2c->pool_free = 0;
+
+    i2c_slave_mem_free(i2c, i2c->tx_ring.buf);
+    i2c_slave_ring_init(&i2c->tx_ring, NULL, 0);
 
     if (i2c->event_queue) {
         vQueueDelete(i2c->event_queue);
         i2c->event_queue = NULL;
     }
 
+    i2c_slave_mem_free(i2c, i2c->event_ring.buf);
+    i2c_slave_ring_init(&i2c->event_ring, NULL, 0);
+
+    i2c->static_mem = NULL;
+    i2c->static_left = 0;
+
     i2c->rx_data_count = 0;
+    i2c->isr_cmd_len = 0;
+    i2c->rx_chunked = false;
+    i2c->rx_stream_offset = 0;
+    i2c->rx_pec_started = false;
+    i2c->tx_stream_active = false;
+    i2c->tx_refill_pending = false;
+    i2c->tx_refill_stretched = false;
+    i2c->regmap_ptr_next = true;
+    i2c->regmap_tx_pushed = 0;
+    i2c->regmap_dirty_lo = i2c->regmap_size;
+    i2c->regmap_dirty_hi = 0;
+    i2c->regmap_pending = false;
+}
+
+static void * i2c_slave_mem_alloc(i2c_slave_struct_t * i2c, size_t size)
+{
+    if(!i2c->static_mem){
+        return malloc(size);
+    }
+    size = I2C_SLAVE_STATIC_ALIGN(size);
+    if(size > i2c->static_left){
+        ESP_LOGE(i2c->tag, "static_mem too small, %u more bytes needed", size - i2c->static_left);
+        return NULL;
+    }
+    void * ptr = i2c->static_mem;
+    i2c->static_mem += size;
+    i2c->static_left -= size;
+    return ptr;
+}
+
+static void i2c_slave_mem_free(i2c_slave_struct_t * i2c, void * ptr)
+{
+    //the arena is owned by the application
+    if(!i2c->static_mem){
+        free(ptr);
+    }
+}
+
+static void i2c_slave_intr_alloc(void * arg)
+{
+    i2c_slave_intr_args_t * args = (i2c_slave_intr_args_t *)arg;
+    args->ret = esp_intr_alloc(i2c_slave_hal_intr_source(args->i2c->num), args->flags, &i2c_slave_isr_handler, args->i2c, &args->i2c->intr_handle);
 }
 
 static bool i2c_slave_set_frequency(i2c_slave_struct_t * i2c, uint32_t clk_speed)
@@ -529,21 +1166,17 @@ static bool i2c_slave_set_frequency(i2c_slave_struct_t * i2c, uint32_t clk_speed
         clk_speed = 1100000UL;
     }
 
-    // Adjust Fifo thresholds based on frequency
+    // Adjust Fifo thresholds based on frequency, unless set by i2cSlaveSetFifoThresholds
     uint32_t a = (clk_speed / 50000L) + 2;
-    ESP_LOGD(TAG, "Fifo thresholds: rx_fifo_full = %" PRIu32 ", tx_fifo_empty = %" PRIu32, SOC_I2C_FIFO_LEN - a, a);
-
-    i2c_clk_cal_t clk_cal;
-#if SOC_I2C_SUPPORT_APB
-    i2c_ll_cal_bus_clk(APB_CLK_FREQ, clk_speed, &clk_cal);
-    i2c_ll_set_source_clk(i2c->dev, I2C_SCLK_APB);            /*!< I2C source clock from APB, 80M*/
-#elif SOC_I2C_SUPPORT_XTAL
-    i2c_ll_cal_bus_clk(XTAL_CLK_FREQ, clk_speed, &clk_cal);
-    i2c_ll_set_source_clk(i2c->dev, I2C_SCLK_XTAL);           /*!< I2C source clock from XTAL, 40M */
-#endif
-    i2c_ll_set_txfifo_empty_thr(i2c->dev, a);
-    i2c_ll_set_rxfifo_full_thr(i2c->dev, SOC_I2C_FIFO_LEN - a);
-    i2c_ll_set_bus_timing(i2c->dev, &clk_cal);
+    i2c->rx_fifo_thr = i2c->rx_fifo_thr_cfg ? i2c->rx_fifo_thr_cfg : (SOC_I2C_FIFO_LEN - a);
+    i2c->tx_fifo_thr = i2c->tx_fifo_thr_cfg ? i2c->tx_fifo_thr_cfg : a;
+    i2c->rx_fifo_clean = 0;
+    i2c->tx_fifo_clean = 0;
+    ESP_LOGD(i2c->tag, "Fifo thresholds: rx_fifo_full = %u, tx_fifo_empty = %u", i2c->rx_fifo_thr, i2c->tx_fifo_thr);
+
+    i2c_slave_hal_set_bus_clk(i2c->dev, clk_speed);
+    i2c_ll_set_txfifo_empty_thr(i2c->dev, i2c->tx_fifo_thr);
+    i2c_ll_set_rxfifo_full_thr(i2c->dev, i2c->rx_fifo_thr);
     i2c_ll_set_filter(i2c->dev, 3);
     return true;
 }
@@ -616,136 +1249,501 @@ static bool i2c_slave_check_line_state(int8_t sda, int8_t scl)
     return true;
 }
 
-static bool i2c_slave_attach_gpio(i2c_slave_struct_t * i2c, int8_t sda, int8_t scl)
+static bool i2c_slave_attach_gpio(i2c_slave_struct_t * i2c, int8_t sda, int8_t scl)
+{
+    if (i2c == NULL) {
+        ESP_LOGE(TAG, "no control block");
+        return false;
+    }
+    
+    if ((sda < 0)||( scl < 0)) {
+        ESP_LOGE(i2c->tag, "bad pins sda=%d, scl=%d",sda,scl);
+        return false;
+    }
+
+    i2c->scl = scl;
+    gpio_set_level(scl, 1);
+    i2c_slave_gpio_mode(scl, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_matrix_out(scl, I2C_SCL_IDX(i2c->num), false, false);
+    gpio_matrix_in(scl, I2C_SCL_IDX(i2c->num), false);
+
+    i2c->sda = sda;
+    gpio_set_level(sda, 1);
+    i2c_slave_gpio_mode(sda, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_matrix_out(sda, I2C_SDA_IDX(i2c->num), false, false);
+    gpio_matrix_in(sda, I2C_SDA_IDX(i2c->num), false);
+
+    return true;
+}
+
+static bool i2c_slave_detach_gpio(i2c_slave_struct_t * i2c)
+{
+    if (i2c == NULL) {
+        ESP_LOGE(TAG, "no control Block");
+        return false;
+    }
+    if (i2c->scl >= 0) {
+        gpio_matrix_out(i2c->scl, 0x100, false, false);
+        gpio_matrix_in(0x30, I2C_SCL_IDX(i2c->num), false);
+        i2c_slave_gpio_mode(i2c->scl, GPIO_MODE_INPUT);
+        i2c->scl = -1; // un attached
+    }
+    if (i2c->sda >= 0) {
+        gpio_matrix_out(i2c->sda, 0x100, false, false);
+        gpio_matrix_in(0x30, I2C_SDA_IDX(i2c->num), false);
+        i2c_slave_gpio_mode(i2c->sda, GPIO_MODE_INPUT);
+        i2c->sda = -1; // un attached
+    }
+    return true;
+}
+
+static bool I2C_SLAVE_ISR_ATTR i2c_slave_send_event(i2c_slave_struct_t * i2c, i2c_slave_queue_event_t* event)
+{
+    bool pxHigherPriorityTaskWoken = false;
+    if(i2c->polled) {
+        i2c_slave_dispatch_event(i2c, event);
+    } else if(i2c->event_ring.size) {
+        //the ISR is the only producer, a record is published whole or not at all
+        if(i2c_slave_ring_space(&i2c->event_ring) < sizeof(i2c_slave_queue_event_t)){
+            i2c->stats.event_overflows++;
+        } else {
+            i2c_slave_ring_write(&i2c->event_ring, (const uint8_t *)event, sizeof(i2c_slave_queue_event_t));
+            //no reader has blocked yet without the worker, it finds the event in the ring
+            TaskHandle_t task = i2c->event_task;
+            if(task){
+                vTaskNotifyGiveFromISR(task, (BaseType_t * const)&pxHigherPriorityTaskWoken);
+            }
+        }
+    } else if(i2c->event_queue) {
+        if(xQueueSendFromISR(i2c->event_queue, event, (BaseType_t * const)&pxHigherPriorityTaskWoken) != pdTRUE){
+            i2c->stats.event_overflows++;
+        }
+    }
+    return pxHigherPriorityTaskWoken;
+}
+
+static inline void I2C_SLAVE_ISR_ATTR i2c_slave_stretch_release(i2c_slave_struct_t * i2c)
+{
+    i2c_ll_stretch_clr(i2c->dev);
+    if(!i2c->stretch_timed){
+        //no master read stretch interrupt on the ESP32, there is nothing to time
+        return;
+    }
+    i2c->stretch_timed = false;
+    //cycle counters are per core, a worker releasing on the other one falls back to esp_timer
+    uint32_t us;
+    if(i2c_slave_core_id() == i2c->stretch_core){
+        us = (i2c_slave_cycles() - i2c->stretch_start_cycles) / i2c_slave_cycles_per_us();
+    } else {
+        us = (uint32_t)(esp_timer_get_time() - i2c->stretch_start_us);
+    }
+    uint32_t bin = us ? 32 - __builtin_clz(us) : 0;
+    if(bin >= I2C_SLAVE_STRETCH_HIST_BINS){
+        bin = I2C_SLAVE_STRETCH_HIST_BINS - 1;
+    }
+    i2c->stats.stretch_hist[bin]++;
+    i2c->stats.stretches++;
+    if(us > i2c->stats.stretch_max_us){
+        i2c->stats.stretch_max_us = us;
+    }
+}
+
+static uint32_t I2C_SLAVE_ISR_ATTR i2c_slave_fill_tx(i2c_slave_struct_t * i2c, const uint8_t *buf, uint32_t len)
+{
+    uint32_t to_queue = 0, to_fifo = 0;
+    const uint8_t * start = buf;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    i2c_ll_get_txfifo_len(i2c->dev, &to_fifo);
+#else
+    to_fifo = i2c_ll_get_txfifo_len(i2c->dev);
+#endif
+
+    if(to_fifo){
+        //reset tx_ring before the FIFO, so nothing queued behind the old response follows the new one
+        i2c_slave_tx_flush(i2c);
+        if(len < to_fifo){
+            to_fifo = len;
+        }
+        i2c_ll_write_txfifo(i2c->dev, (uint8_t*)buf, to_fifo);
+        i2c_slave_tx_loaded(i2c, buf, to_fifo);
+        buf += to_fifo;
+        len -= to_fifo;
+        //write the rest of the bytes to the ring
+        if(len){
+            to_queue = i2c_slave_ring_write(&i2c->tx_ring, buf, len);
+            //no need to enable TX_EMPTY if tx_ring is empty
+            if(to_queue){
+                i2c_ll_slave_enable_tx_it(i2c->dev);
+            }
+        }
+    }
+    if(i2c->pec_enabled){
+        i2c->tx_pec = smbus_pec_update(i2c->tx_pec, start, to_queue + to_fifo);
+    }
+    return to_queue + to_fifo;
+}
+
+// drop the pending response from tx_ring. i2cSlaveWrite and friends may run while the ISR is still
+// draining the previous one on the other core, so the consumer side tail is moved under the spinlock
+// the ISR holds around its ring reads. What already went to the FIFO is still sent, the PEC restarts from it
+static void I2C_SLAVE_ISR_ATTR i2c_slave_tx_flush(i2c_slave_struct_t * i2c)
+{
+    portENTER_CRITICAL_SAFE(&i2c->spinlock);
+    i2c_slave_ring_flush(&i2c->tx_ring);
+    i2c->tx_pec = i2c->tx_pec_fifo;
+    portEXIT_CRITICAL_SAFE(&i2c->spinlock);
+}
+
+// move as much of tx_ring as fits into the TX FIFO. The lock keeps i2c_slave_tx_flush, and the other
+// of ISR and i2cSlaveWriteCommit, from moving tail between peek and consume
+static void I2C_SLAVE_ISR_ATTR i2c_slave_tx_drain(i2c_slave_struct_t * i2c)
+{
+    uint32_t moveCnt = 0, n = 0;
+    uint8_t * span = NULL;
+    portENTER_CRITICAL_SAFE(&i2c->spinlock);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    i2c_ll_get_txfifo_len(i2c->dev, &moveCnt);
+#else
+    moveCnt = i2c_ll_get_txfifo_len(i2c->dev);
+#endif
+    // one bulk write per contiguous span, until Fifo is full or ring is empty
+    while (moveCnt > 0 && (n = i2c_slave_ring_peek(&i2c->tx_ring, &span)) > 0) {
+        if(n > moveCnt){
+            n = moveCnt;
+        }
+        i2c_ll_write_txfifo(i2c->dev, span, n);
+        i2c_slave_tx_loaded(i2c, span, n);
+        i2c_slave_ring_consume(&i2c->tx_ring, n);
+        moveCnt -= n;
+    }
+    portEXIT_CRITICAL_SAFE(&i2c->spinlock);
+}
+
+// true when the calling task holds the port lock from i2cSlaveWriteBegin, tx_staging is only read with it held
+static bool i2c_slave_tx_staging_owner(i2c_slave_struct_t * i2c)
 {
-    if (i2c == NULL) {
-        ESP_LOGE(TAG, "no control block");
-        return false;
-    }
-    
-    if ((sda < 0)||( scl < 0)) {
-        ESP_LOGE(TAG, "bad pins sda=%d, scl=%d",sda,scl);
+#if !CONFIG_DISABLE_HAL_LOCKS
+    if(!i2c->lock || xSemaphoreGetMutexHolder(i2c->lock) != xTaskGetCurrentTaskHandle()){
         return false;
     }
+#endif
+    return i2c->tx_staging;
+}
 
-    i2c->scl = scl;
-    gpio_set_level(scl, 1);
-    i2c_slave_gpio_mode(scl, GPIO_MODE_INPUT_OUTPUT_OD);
-    gpio_matrix_out(scl, I2C_SCL_IDX(i2c->num), false, false);
-    gpio_matrix_in(scl, I2C_SCL_IDX(i2c->num), false);
+// account for n bytes of buf just written to the TX FIFO
+static inline void I2C_SLAVE_ISR_ATTR i2c_slave_tx_loaded(i2c_slave_struct_t * i2c, const uint8_t * buf, uint32_t n)
+{
+    i2c->stats.tx_bytes += n;
+    i2c->trans_tx_bytes += n;
+    if(i2c->pec_enabled){
+        i2c->tx_pec_fifo = smbus_pec_update(i2c->tx_pec_fifo, buf, n);
+    }
+}
 
-    i2c->sda = sda;
-    gpio_set_level(sda, 1);
-    i2c_slave_gpio_mode(sda, GPIO_MODE_INPUT_OUTPUT_OD);
-    gpio_matrix_out(sda, I2C_SDA_IDX(i2c->num), false, false);
-    gpio_matrix_in(sda, I2C_SDA_IDX(i2c->num), false);
+static void i2c_slave_write_prepare(i2c_slave_struct_t * i2c)
+{
+#if CONFIG_IDF_TARGET_ESP32
+    i2c_ll_slave_disable_tx_it(i2c->dev);
+    uint32_t txfifo_len = 0;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    i2c_ll_get_txfifo_len(i2c->dev, &txfifo_len);
+#else
+    txfifo_len = i2c_ll_get_txfifo_len(i2c->dev);
+#endif
+    if (txfifo_len < SOC_I2C_FIFO_LEN) {
+        i2c_ll_txfifo_rst(i2c->dev);
+    }
+#endif
+}
 
-    return true;
+// make the staged bytes visible to the ISR with a single head update
+static void i2c_slave_tx_publish(i2c_slave_struct_t * i2c)
+{
+    uint32_t staged = i2c->tx_staged;
+    i2c->tx_staged = 0;
+    if(!staged){
+        return;
+    }
+    if(i2c->pec_enabled){
+        uint8_t * span = NULL;
+        uint32_t first = i2c_slave_ring_reserve(&i2c->tx_ring, &span);
+        if(first > staged){
+            first = staged;
+        }
+        i2c->tx_pec = smbus_pec_update(i2c->tx_pec, span, first);
+        i2c->tx_pec = smbus_pec_update(i2c->tx_pec, i2c->tx_ring.buf, staged - first);
+    }
+    i2c_slave_ring_commit(&i2c->tx_ring, staged);
+    i2c_ll_slave_enable_tx_it(i2c->dev);
 }
 
-static bool i2c_slave_detach_gpio(i2c_slave_struct_t * i2c)
+// queue bytes behind what is already in the TX FIFO and ring, unlike i2c_slave_fill_tx nothing is flushed
+static void I2C_SLAVE_ISR_ATTR i2c_slave_tx_append(i2c_slave_struct_t * i2c, const uint8_t *buf, uint32_t len)
 {
-    if (i2c == NULL) {
-        ESP_LOGE(TAG, "no control Block");
-        return false;
+    uint32_t to_fifo = 0;
+    if(!i2c_slave_ring_count(&i2c->tx_ring)){
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+        i2c_ll_get_txfifo_len(i2c->dev, &to_fifo);
+#else
+        to_fifo = i2c_ll_get_txfifo_len(i2c->dev);
+#endif
+        if(to_fifo > len){
+            to_fifo = len;
+        }
+        i2c_ll_write_txfifo(i2c->dev, (uint8_t*)buf, to_fifo);
+        i2c_slave_tx_loaded(i2c, buf, to_fifo);
     }
-    if (i2c->scl >= 0) {
-        gpio_matrix_out(i2c->scl, 0x100, false, false);
-        gpio_matrix_in(0x30, I2C_SCL_IDX(i2c->num), false);
-        i2c_slave_gpio_mode(i2c->scl, GPIO_MODE_INPUT);
-        i2c->scl = -1; // un attached
+    if(len > to_fifo && i2c_slave_ring_write(&i2c->tx_ring, buf + to_fifo, len - to_fifo)){
+        i2c_ll_slave_enable_tx_it(i2c->dev);
     }
-    if (i2c->sda >= 0) {
-        gpio_matrix_out(i2c->sda, 0x100, false, false);
-        gpio_matrix_in(0x30, I2C_SDA_IDX(i2c->num), false);
-        i2c_slave_gpio_mode(i2c->sda, GPIO_MODE_INPUT);
-        i2c->sda = -1; // un attached
+}
+
+static inline void I2C_SLAVE_ISR_ATTR i2c_slave_capture_cmd(i2c_slave_struct_t * i2c, const uint8_t * data, uint32_t len)
+{
+    if(i2c->pec_enabled){
+        if(!i2c->rx_pec_started){
+            i2c->rx_pec = smbus_pec_byte(SMBUS_PEC_INIT, (uint8_t)(i2c->slave_addr << 1));
+            i2c->rx_pec_started = true;
+        }
+        i2c->rx_pec = smbus_pec_update(i2c->rx_pec, data, len);
+    }
+    if(i2c->isr_request_callback || i2c->slots){
+        while(len-- && i2c->isr_cmd_len < I2C_SLAVE_ISR_CMD_MAX_LEN){
+            i2c->isr_cmd[i2c->isr_cmd_len++] = *data++;
+        }
     }
-    return true;
 }
 
-static bool i2c_slave_send_event(i2c_slave_struct_t * i2c, i2c_slave_queue_event_t* event)
+static void I2C_SLAVE_ISR_ATTR i2c_slave_regmap_rx(i2c_slave_struct_t * i2c, const uint8_t * data, uint32_t len)
 {
-    bool pxHigherPriorityTaskWoken = false;
-    if(i2c->event_queue) {
-        if(xQueueSendFromISR(i2c->event_queue, event, (BaseType_t * const)&pxHigherPriorityTaskWoken) != pdTRUE){
-            //ESP_LOGE(TAG, "event_queue_full");
+    portENTER_CRITICAL_ISR(&i2c->spinlock);
+    while(len--){
+        if(i2c->regmap_ptr_next){
+            i2c->regmap_ptr = *data++ % i2c->regmap_size;
+            i2c->regmap_ptr_next = false;
+            continue;
+        }
+        uint32_t ptr = i2c->regmap_ptr;
+        i2c->regmap[ptr] = *data++;
+        if(ptr < i2c->regmap_dirty_lo){
+            i2c->regmap_dirty_lo = ptr;
         }
+        if(ptr >= i2c->regmap_dirty_hi){
+            i2c->regmap_dirty_hi = ptr + 1;
+        }
+        i2c->regmap_ptr = (ptr + 1 == i2c->regmap_size) ? 0 : (ptr + 1);
     }
-    return pxHigherPriorityTaskWoken;
+    portEXIT_CRITICAL_ISR(&i2c->spinlock);
 }
 
-static bool i2c_slave_handle_tx_fifo_empty(i2c_slave_struct_t * i2c)
+static void I2C_SLAVE_ISR_ATTR i2c_slave_regmap_tx(i2c_slave_struct_t * i2c)
 {
-    bool pxHigherPriorityTaskWoken = false;
-    uint32_t d = 0, moveCnt = 0;
+    uint32_t space = 0;
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-    i2c_ll_get_txfifo_len(i2c->dev, &moveCnt);
+    i2c_ll_get_txfifo_len(i2c->dev, &space);
 #else
-    moveCnt = i2c_ll_get_txfifo_len(i2c->dev);
+    space = i2c_ll_get_txfifo_len(i2c->dev);
 #endif
-    while (moveCnt > 0) { // read tx queue until Fifo is full or queue is empty
-        if(xQueueReceiveFromISR(i2c->tx_queue, &d, (BaseType_t * const)&pxHigherPriorityTaskWoken) == pdTRUE){
-            i2c_ll_write_txfifo(i2c->dev, (uint8_t*)&d, 1);
-            moveCnt--;
-        } else {
-            i2c_ll_slave_disable_tx_it(i2c->dev);
-            break;
+    portENTER_CRITICAL_ISR(&i2c->spinlock);
+    while(space){
+        uint32_t ptr = (i2c->regmap_ptr + i2c->regmap_tx_pushed) % i2c->regmap_size;
+        uint32_t n = i2c->regmap_size - ptr;
+        if(n > space){
+            n = space;
         }
+        i2c_ll_write_txfifo(i2c->dev, i2c->regmap + ptr, n);
+        i2c->stats.tx_bytes += n;
+        i2c->trans_tx_bytes += n;
+        i2c->regmap_tx_pushed += n;
+        space -= n;
     }
-    return pxHigherPriorityTaskWoken;
+    portEXIT_CRITICAL_ISR(&i2c->spinlock);
 }
 
-static bool i2c_slave_handle_rx_fifo_full(i2c_slave_struct_t * i2c, uint32_t len)
+static bool I2C_SLAVE_ISR_ATTR i2c_slave_isr_answer(i2c_slave_struct_t * i2c)
+{
+    if(i2c->rx_chunked){
+        //isr_cmd holds the head of a long write, not the command before this read
+        return false;
+    }
+    if(i2c->slots && i2c->rx_data_count && i2c->isr_cmd[0] < i2c->slot_count){
+        i2c_slave_slot_t * slot = &i2c->slots[i2c->isr_cmd[0]];
+        uint32_t front = __atomic_fetch_or(&slot->ctrl, I2C_SLAVE_SLOT_BUSY, __ATOMIC_ACQ_REL) & I2C_SLAVE_SLOT_FRONT;
+        uint32_t len = slot->len[front];
+        if(len){
+            i2c_slave_fill_tx(i2c, i2c->slots_buf + (i2c->isr_cmd[0] * 2 + front) * i2c->slot_max_len, len);
+        }
+        __atomic_fetch_and(&slot->ctrl, ~I2C_SLAVE_SLOT_BUSY, __ATOMIC_RELEASE);
+        if(len){
+            return true;
+        }
+    }
+    return i2c->isr_request_callback && i2c->rx_data_count <= I2C_SLAVE_ISR_CMD_MAX_LEN
+        && i2c->isr_request_callback(i2c->num, i2c->isr_cmd, i2c->rx_data_count, i2c->isr_arg);
+}
+
+static bool I2C_SLAVE_ISR_ATTR i2c_slave_handle_tx_fifo_empty(i2c_slave_struct_t * i2c)
+{
+    if(i2c->regmap){
+        i2c_slave_regmap_tx(i2c);
+        return false;
+    }
+    i2c_slave_tx_drain(i2c);
+    uint32_t queued = i2c_slave_ring_count(&i2c->tx_ring);
+    if(!queued){
+        i2c_ll_slave_disable_tx_it(i2c->dev);
+    }
+    if(i2c->tx_stream_active && queued < i2c->tx_low_water && !i2c->tx_refill_pending){
+        //SEND one refill request until the worker has picked it up
+        i2c_slave_queue_event_t event;
+        event.event = I2C_SLAVE_EVT_TX_REFILL;
+        event.param = 0;
+        event.time_us = (uint32_t)esp_timer_get_time();
+        i2c->tx_refill_pending = true;
+        return i2c_slave_send_event(i2c, &event);
+    }
+    return false;
+}
+
+static bool I2C_SLAVE_ISR_ATTR i2c_slave_handle_rx_fifo_full(i2c_slave_struct_t * i2c, uint32_t len)
 {
-#if I2C_SLAVE_USE_RX_QUEUE
-    uint32_t d = 0;
-#else
     uint8_t data[SOC_I2C_FIFO_LEN];
-#endif
     bool pxHigherPriorityTaskWoken = false;
-#if I2C_SLAVE_USE_RX_QUEUE
-    while (len > 0) {
-        i2c_ll_read_rxfifo(i2c->dev, (uint8_t*)&d, 1);
-        if(xQueueSendFromISR(i2c->rx_queue, &d, (BaseType_t * const)&pxHigherPriorityTaskWoken) != pdTRUE){
-            ESP_LOGE(TAG, "rx_queue_full");
-        } else {
-            i2c->rx_data_count++;
+    uint32_t start = i2c_slave_cycles();
+    uint32_t moved = 0;
+    if(i2c->regmap){
+        i2c_ll_read_rxfifo(i2c->dev, data, len);
+        i2c_slave_regmap_rx(i2c, data, len);
+        moved = len;
+    } else if(i2c->rx_mode == I2C_SLAVE_RX_RING){
+        uint8_t * span = NULL;
+        while(len){
+            uint32_t n = i2c_slave_ring_reserve(&i2c->rx_ring, &span);
+            if(!n){
+                i2c_ll_read_rxfifo(i2c->dev, data, len);
+                moved += len;
+                i2c->stats.rx_overflows += len;
+                break;
+            }
+            if(n > len){
+                n = len;
+            }
+            i2c_ll_read_rxfifo(i2c->dev, span, n);
+            i2c_slave_capture_cmd(i2c, span, n);
+            i2c_slave_ring_commit(&i2c->rx_ring, n);
+            i2c->rx_data_count += n;
+            moved += n;
+            len -= n;
         }
-        if (--len == 0) {
+    } else if(i2c->rx_mode == I2C_SLAVE_RX_QUEUE){
+        while (len > 0) {
+            i2c_ll_read_rxfifo(i2c->dev, data, 1);
+            i2c_slave_capture_cmd(i2c, data, 1);
+            moved++;
+            if(xQueueSendFromISR(i2c->rx_queue, data, (BaseType_t * const)&pxHigherPriorityTaskWoken) != pdTRUE){
+                i2c->stats.rx_overflows++;
+            } else {
+                i2c->rx_data_count++;
+            }
+            if (--len == 0) {
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-            i2c_ll_get_rxfifo_cnt(i2c->dev, &len);
+                i2c_ll_get_rxfifo_cnt(i2c->dev, &len);
 #else
-            len = i2c_ll_get_rxfifo_cnt(i2c->dev);
+                len = i2c_ll_get_rxfifo_cnt(i2c->dev);
 #endif
+            }
         }
-#else
-    if(len){
+    } else if(len){
         i2c_ll_read_rxfifo(i2c->dev, data, len);
+        i2c_slave_capture_cmd(i2c, data, len);
+        moved = len;
         if(xRingbufferSendFromISR(i2c->rx_ring_buf, (void*) data, len, (BaseType_t * const)&pxHigherPriorityTaskWoken) != pdTRUE){
-            ESP_LOGE(TAG, "rx_ring_buf_full");
+            i2c->stats.rx_overflows += len;
         } else {
             i2c->rx_data_count += len;
         }
-#endif
     }
+    if(i2c->rx_chunk_len && i2c->rx_data_count >= i2c->rx_chunk_len){
+        //SEND RX chunk, the ring keeps filling while the worker consumes it
+        i2c_slave_queue_event_t event;
+        event.event = I2C_SLAVE_EVT_RX_CHUNK;
+        event.stop = 0;
+        event.param = i2c->rx_data_count;
+        event.time_us = (uint32_t)esp_timer_get_time();
+        event.pec = I2C_SLAVE_PEC_NONE;
+        pxHigherPriorityTaskWoken |= i2c_slave_send_event(i2c, &event);
+        i2c->rx_data_count = 0;
+        i2c->rx_chunked = true;
+    }
+    i2c->stats.rx_isr_calls++;
+    i2c->stats.rx_isr_bytes += moved;
+    i2c->trans_rx_bytes += moved;
+    i2c->stats.rx_isr_cycles += i2c_slave_cycles() - start;
     return pxHigherPriorityTaskWoken;
 }
 
-static void i2c_slave_isr_handler(void* arg)
+#define I2C_SLAVE_FIFO_THR_STEP_UP   2 // watermark step after a FIFO stretch
+#define I2C_SLAVE_FIFO_THR_RELAX     8 // clean long transactions before moving the watermark back by one
+
+static void I2C_SLAVE_ISR_ATTR i2c_slave_tune_fifo(i2c_slave_struct_t * i2c, bool read, uint32_t bytes)
+{
+    //only transactions longer than the FIFO go through the watermark interrupts,
+    //short polls neither cost an interrupt nor tell anything about the margin
+    if(bytes <= SOC_I2C_FIFO_LEN){
+        return;
+    }
+    if(read){
+        if(i2c->tx_fifo_stretched){
+            //refilled too late, ask for the interrupt with more bytes left
+            i2c->tx_fifo_thr += I2C_SLAVE_FIFO_THR_STEP_UP;
+            if(i2c->tx_fifo_thr > SOC_I2C_FIFO_LEN - 1){
+                i2c->tx_fifo_thr = SOC_I2C_FIFO_LEN - 1;
+            }
+            i2c->tx_fifo_clean = 0;
+        } else if(++i2c->tx_fifo_clean >= I2C_SLAVE_FIFO_THR_RELAX && i2c->tx_fifo_thr > 1){
+            //fewer refill interrupts per byte
+            i2c->tx_fifo_thr--;
+            i2c->tx_fifo_clean = 0;
+        } else {
+            return;
+        }
+        i2c_ll_set_txfifo_empty_thr(i2c->dev, i2c->tx_fifo_thr);
+    } else {
+        if(i2c->rx_fifo_stretched){
+            //drained too late, interrupt with more room left
+            i2c->rx_fifo_thr = (i2c->rx_fifo_thr > I2C_SLAVE_FIFO_THR_STEP_UP) ? (i2c->rx_fifo_thr - I2C_SLAVE_FIFO_THR_STEP_UP) : 1;
+            i2c->rx_fifo_clean = 0;
+        } else if(++i2c->rx_fifo_clean >= I2C_SLAVE_FIFO_THR_RELAX && i2c->rx_fifo_thr < SOC_I2C_FIFO_LEN - 1){
+            //fewer drain interrupts per byte
+            i2c->rx_fifo_thr++;
+            i2c->rx_fifo_clean = 0;
+        } else {
+            return;
+        }
+        i2c_ll_set_rxfifo_full_thr(i2c->dev, i2c->rx_fifo_thr);
+    }
+}
+
+static bool I2C_SLAVE_ISR_ATTR i2c_slave_service(i2c_slave_struct_t * i2c)
 {
     bool pxHigherPriorityTaskWoken = false;
-    i2c_slave_struct_t * i2c = (i2c_slave_struct_t *) arg; // recover data
+    uint32_t start = i2c_slave_cycles();
 
     uint32_t activeInt = 0;
     uint32_t rx_fifo_len = 0;
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
     i2c_ll_get_intr_mask(i2c->dev, &activeInt);
-    i2c_ll_clr_intsts_mask(i2c->dev, activeInt);
-    i2c_ll_get_rxfifo_cnt(i2c->dev, &rx_fifo_len);
 #else
     activeInt = i2c_ll_get_intsts_mask(i2c->dev);
+#endif
+    if(!activeInt){
+        //shared interrupt or idle poll, nothing to do
+        return false;
+    }
     i2c_ll_clr_intsts_mask(i2c->dev, activeInt);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    i2c_ll_get_rxfifo_cnt(i2c->dev, &rx_fifo_len);
+#else
     rx_fifo_len = i2c_ll_get_rxfifo_cnt(i2c->dev);
 #endif
     bool slave_rw = i2c_ll_slave_rw(i2c->dev);
@@ -759,29 +1757,81 @@ static void i2c_slave_isr_handler(void* arg)
         if(rx_fifo_len){ //READ RX FIFO
             pxHigherPriorityTaskWoken |= i2c_slave_handle_rx_fifo_full(i2c, rx_fifo_len);
         }
-        if(i2c->rx_data_count){ //WRITE or RepeatedStart
-            //SEND RX Event
+        //only read esp_timer when an event goes out, a plain master read ends without one
+        uint32_t stop_us = 0;
+        if(i2c->rx_data_count || i2c->rx_chunked || (i2c->regmap && i2c->regmap_dirty_hi > i2c->regmap_dirty_lo)){
+            stop_us = (uint32_t)esp_timer_get_time();
+        }
+        if(i2c->regmap){
+            if(slave_rw){ //READ, advance the pointer by the bytes the master clocked out
+                uint32_t txfifo_free = 0;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+                i2c_ll_get_txfifo_len(i2c->dev, &txfifo_free);
+#else
+                txfifo_free = i2c_ll_get_txfifo_len(i2c->dev);
+#endif
+                i2c_ll_slave_disable_tx_it(i2c->dev);
+                i2c->regmap_ptr = (i2c->regmap_ptr + i2c->regmap_tx_pushed - (SOC_I2C_FIFO_LEN - txfifo_free)) % i2c->regmap_size;
+                i2c->regmap_tx_pushed = 0;
+            }
+            i2c->regmap_ptr_next = true;
+            if(i2c->regmap_dirty_hi > i2c->regmap_dirty_lo && !i2c->regmap_pending){
+                //SEND one change notification until the worker has picked it up
+                i2c_slave_queue_event_t event;
+                event.event = I2C_SLAVE_EVT_REGMAP;
+                event.param = 0;
+                event.time_us = stop_us;
+                i2c->regmap_pending = true;
+                pxHigherPriorityTaskWoken |= i2c_slave_send_event(i2c, &event);
+            }
+        }
+        if(i2c->rx_data_count || i2c->rx_chunked){ //WRITE or RepeatedStart
+            //SEND RX Event, also empty to end a chunked write
             i2c_slave_queue_event_t event;
             event.event = I2C_SLAVE_EVT_RX;
             event.stop = !slave_rw;
             event.param = i2c->rx_data_count;
+            event.time_us = stop_us;
+            event.pec = I2C_SLAVE_PEC_NONE;
+            if(i2c->rx_pec_started && i2c->trans_rx_bytes > 1){
+                //the PEC byte itself brings the CRC to 0
+                event.pec = i2c->rx_pec ? I2C_SLAVE_PEC_FAIL : I2C_SLAVE_PEC_OK;
+            }
             pxHigherPriorityTaskWoken |= i2c_slave_send_event(i2c, &event);
+            i2c->stats.rx_transactions++;
             //Zero RX count
             i2c->rx_data_count = 0;
+            i2c->isr_cmd_len = 0;
+            i2c->rx_chunked = false;
+        }
+        if(i2c->fifo_thr_adaptive){
+            if(i2c->trans_rx_bytes){
+                i2c_slave_tune_fifo(i2c, false, i2c->trans_rx_bytes);
+            }
+            if(slave_rw){
+                i2c_slave_tune_fifo(i2c, true, i2c->trans_tx_bytes);
+            }
         }
+        i2c->trans_rx_bytes = 0;
+        i2c->rx_pec_started = false;
+        i2c->rx_fifo_stretched = false;
+        i2c->tx_fifo_stretched = false;
         if(slave_rw){ // READ
+            i2c->stats.tx_transactions++;
 #if CONFIG_IDF_TARGET_ESP32
             if(i2c->dev->status_reg.scl_main_state_last == 6){
                 //SEND TX Event
                 i2c_slave_queue_event_t event;
                 event.event = I2C_SLAVE_EVT_TX;
+                event.param = 0;
+                event.time_us = (uint32_t)esp_timer_get_time();
                 pxHigherPriorityTaskWoken |= i2c_slave_send_event(i2c, &event);
             }
 #else
             //reset TX data
+            i2c->tx_stream_active = false;
             i2c_ll_txfifo_rst(i2c->dev);
-            uint8_t d;
-            while (xQueueReceiveFromISR(i2c->tx_queue, &d, (BaseType_t * const)&pxHigherPriorityTaskWoken) == pdTRUE) ;//flush partial write
+            i2c_slave_ring_flush(&i2c->tx_ring);//flush partial write
 #endif
         }
     }
@@ -790,25 +1840,70 @@ static void i2c_slave_isr_handler(void* arg)
     if(activeInt & I2C_SLAVE_STRETCH_INT_ENA){ // STRETCH
         i2c_stretch_cause_t cause = i2c_ll_stretch_cause(i2c->dev);
         if(cause == I2C_STRETCH_CAUSE_MASTER_READ){
+            i2c->stretch_start_cycles = i2c_slave_cycles();
+            i2c->stretch_core = i2c_slave_core_id();
+            i2c->stretch_timed = true;
+            i2c->tx_stream_active = false;
+            i2c->tx_refill_stretched = false;
+            i2c->trans_tx_bytes = 0;
             //on C3 RX data dissapears with repeated start, so we need to get it here
             if(rx_fifo_len){
                 pxHigherPriorityTaskWoken |= i2c_slave_handle_rx_fifo_full(i2c, rx_fifo_len);
             }
-            //SEND TX Event
+            if(i2c->pec_enabled){
+                //the PEC of a read covers the command write before the repeated START, drained just above
+                i2c->tx_pec = smbus_pec_byte(i2c->rx_pec_started ? i2c->rx_pec : SMBUS_PEC_INIT, (uint8_t)(i2c->slave_addr << 1 | 1));
+                i2c->tx_pec_fifo = i2c->tx_pec;
+                i2c->rx_pec_started = false;
+            }
             i2c_slave_queue_event_t event;
-            if (i2c->rx_data_count) {
-                event.param = i2c->rx_data_count;
+            event.param = i2c->rx_data_count;
+            if(i2c->regmap){
+                //serve the read straight from the register map
+                i2c->regmap_ptr_next = true;
+                i2c->regmap_tx_pushed = 0;
+                i2c_slave_regmap_tx(i2c);
+                i2c_ll_slave_enable_tx_it(i2c->dev);
+                i2c_slave_stretch_release(i2c);
+            } else if(i2c_slave_isr_answer(i2c)){
+                if(i2c->pec_enabled){
+                    i2c_slave_tx_append(i2c, &i2c->tx_pec, 1);
+                }
+                //answered in the ISR, the command bytes are not needed anymore
+                if(i2c->rx_mode == I2C_SLAVE_RX_RING){
+                    i2c_slave_ring_uncommit(&i2c->rx_ring, i2c->rx_data_count);
+                } else if(i2c->rx_data_count){
+                    event.event = I2C_SLAVE_EVT_SKIP;
+                    event.time_us = (uint32_t)esp_timer_get_time();
+                    pxHigherPriorityTaskWoken |= i2c_slave_send_event(i2c, &event);
+                }
+                i2c_slave_stretch_release(i2c);
             } else {
-                event.param = 0;
+                //SEND TX Event, the worker may release the stretch on the other core
+                i2c->stretch_start_us = esp_timer_get_time();
+                event.event = I2C_SLAVE_EVT_TX;
+                event.time_us = (uint32_t)i2c->stretch_start_us;
+                pxHigherPriorityTaskWoken |= i2c_slave_send_event(i2c, &event);
+                //will clear after execution
             }
-            event.event = I2C_SLAVE_EVT_TX;
-            pxHigherPriorityTaskWoken |= i2c_slave_send_event(i2c, &event);
             i2c->rx_data_count = 0;
-            //will clear after execution
+            i2c->isr_cmd_len = 0;
         } else if(cause == I2C_STRETCH_CAUSE_TX_FIFO_EMPTY){
+            i2c->stats.tx_empty_stretches++;
+            i2c->tx_fifo_stretched = true;
+            bool hold = i2c->tx_stream_active && !i2c_slave_ring_count(&i2c->tx_ring);
+            if(hold){
+                //the producer is behind the master, hold SCL until the worker has refilled,
+                //in polled mode the refill is dispatched inline and releases it before returning
+                __atomic_store_n(&i2c->tx_refill_stretched, true, __ATOMIC_SEQ_CST);
+            }
             pxHigherPriorityTaskWoken |= i2c_slave_handle_tx_fifo_empty(i2c);
-            i2c_ll_stretch_clr(i2c->dev);
+            if(!hold){
+                i2c_ll_stretch_clr(i2c->dev);
+            }
         } else if(cause == I2C_STRETCH_CAUSE_RX_FIFO_FULL){
+            i2c->stats.rx_full_stretches++;
+            i2c->rx_fifo_stretched = true;
             pxHigherPriorityTaskWoken |= i2c_slave_handle_rx_fifo_full(i2c, rx_fifo_len);
             i2c_ll_stretch_clr(i2c->dev);
         }
@@ -819,7 +1914,15 @@ static void i2c_slave_isr_handler(void* arg)
         pxHigherPriorityTaskWoken |= i2c_slave_handle_tx_fifo_empty(i2c);
     }
 
-    if(pxHigherPriorityTaskWoken){
+    i2c->stats.isr_calls++;
+    i2c->stats.isr_cycles += i2c_slave_cycles() - start;
+    return pxHigherPriorityTaskWoken;
+}
+
+static void I2C_SLAVE_ISR_ATTR i2c_slave_isr_handler(void* arg)
+{
+    i2c_slave_struct_t * i2c = (i2c_slave_struct_t *) arg; // recover data
+    if(i2c_slave_service(i2c)){
         portYIELD_FROM_ISR();
     }
 }
@@ -828,23 +1931,41 @@ static size_t i2c_slave_read_rx(i2c_slave_struct_t * i2c, uint8_t * data, size_t
     if(!len){
         return 0;
     }
-#if I2C_SLAVE_USE_RX_QUEUE
-    uint8_t d = 0;
-    BaseType_t res = pdTRUE;
-    for(size_t i=0; i<len; i++) {
-        if(data){
-            res = xQueueReceive(i2c->rx_queue, &data[i], 0);
-        } else {
-            res = xQueueReceive(i2c->rx_queue, &d, 0);
+    if(i2c->rx_mode == I2C_SLAVE_RX_RING){
+        uint8_t * span = NULL;
+        size_t n = 0, so_far = 0;
+        while(so_far < len && (n = i2c_slave_ring_peek(&i2c->rx_ring, &span)) > 0){
+            if(n > len - so_far){
+                n = len - so_far;
+            }
+            if(data){
+                memcpy(data+so_far, span, n);
+            }
+            i2c_slave_ring_consume(&i2c->rx_ring, n);
+            so_far+=n;
         }
-        if (res != pdTRUE) {
-            ESP_LOGE(TAG, "Read Queue(%u) Failed", i);
-            len = i;
-            break;
+        if(so_far < len){
+            ESP_LOGE(i2c->tag, "Less available than requested. %u < %u", so_far, len);
         }
+        return (data)?so_far:0;
+    }
+    if(i2c->rx_mode == I2C_SLAVE_RX_QUEUE){
+        uint8_t d = 0;
+        BaseType_t res = pdTRUE;
+        for(size_t i=0; i<len; i++) {
+            if(data){
+                res = xQueueReceive(i2c->rx_queue, &data[i], 0);
+            } else {
+                res = xQueueReceive(i2c->rx_queue, &d, 0);
+            }
+            if (res != pdTRUE) {
+                ESP_LOGE(i2c->tag, "Read Queue(%u) Failed", i);
+                len = i;
+                break;
+            }
+        }
+        return (data)?len:0;
     }
-    return (data)?len:0;
-#else
     size_t  dlen = 0, 
             to_read = len, 
             so_far = 0, 
@@ -853,7 +1974,7 @@ static size_t i2c_slave_read_rx(i2c_slave_struct_t * i2c, uint8_t * data, size_t
 
     vRingbufferGetInfo(i2c->rx_ring_buf, NULL, NULL, NULL, NULL, &available);
     if(available < to_read){
-        ESP_LOGE(TAG, "Less available than requested. %u < %u", available, len);
+        ESP_LOGE(i2c->tag, "Less available than requested. %u < %u", available, len);
         to_read = available;
     }
 
@@ -861,7 +1982,7 @@ static size_t i2c_slave_read_rx(i2c_slave_struct_t * i2c, uint8_t * data, size_t
         dlen = 0;
         rx_data = (uint8_t *)xRingbufferReceiveUpTo(i2c->rx_ring_buf, &dlen, 0, to_read);
         if(!rx_data){
-            ESP_LOGE(TAG, "Receive %u Failed", to_read);
+            ESP_LOGE(i2c->tag, "Receive %u Failed", to_read);
             return so_far;
         }
         if(data){
@@ -872,57 +1993,272 @@ static size_t i2c_slave_read_rx(i2c_slave_struct_t * i2c, uint8_t * data, size_t
         to_read-=dlen;
     }
     return (data)?so_far:0;
+}
+
+static uint8_t * i2c_slave_pool_get(i2c_slave_struct_t * i2c){
+    if(!i2c->pool_free){
+        return NULL;
+    }
+    uint32_t idx = __builtin_ctz(i2c->pool_free);
+    i2c->pool_free &= ~(1UL << idx);
+    return i2c->pool + idx * i2c->pool_buf_len;
+}
+
+static void i2c_slave_pool_put(i2c_slave_struct_t * i2c, uint8_t * buf){
+    if(buf){
+        i2c->pool_free |= 1UL << ((buf - i2c->pool) / i2c->pool_buf_len);
+    }
+}
+
+static uint8_t * i2c_slave_take_rx(i2c_slave_struct_t * i2c, size_t * len, void ** item){
+    uint8_t * data = NULL;
+    size_t dlen = 0;
+    *item = NULL;
+    if(!*len){
+        return NULL;
+    }
+    if(i2c->rx_delivery == I2C_SLAVE_RX_DELIVERY_ZERO_COPY){
+        if(i2c->rx_mode == I2C_SLAVE_RX_RING){
+            if(i2c_slave_ring_peek(&i2c->rx_ring, &data) >= *len){
+                //contiguous in the ring, lend it and consume it on return
+                *item = data;
+                return data;
+            }
+            data = NULL;
+        } else if(i2c->rx_mode == I2C_SLAVE_RX_RINGBUF){
+            data = (uint8_t *)xRingbufferReceiveUpTo(i2c->rx_ring_buf, &dlen, 0, *len);
+            if(data && dlen == *len){
+                //contiguous in the ring, lend it as is
+                *item = data;
+                return data;
+            }
+        }
+    }
+    uint8_t * buf = i2c_slave_pool_get(i2c);
+    if(buf == NULL){
+        //pool exhausted, drop the transaction
+        if(data){
+            vRingbufferReturnItem(i2c->rx_ring_buf, data);
+        }
+        i2c_slave_read_rx(i2c, NULL, *len - dlen);
+        i2c->stats.pool_drops++;
+        *len = 0;
+        return NULL;
+    }
+    if(data){
+        //wrapped around the end of the ring, join both spans in the pool buffer
+        memcpy(buf, data, dlen);
+        vRingbufferReturnItem(i2c->rx_ring_buf, data);
+    }
+    *len = dlen + i2c_slave_read_rx(i2c, buf + dlen, *len - dlen);
+    return buf;
+}
+
+static void i2c_slave_return_rx(i2c_slave_struct_t * i2c, uint8_t * data, size_t len, void * item){
+    if(item){
+        if(i2c->rx_mode == I2C_SLAVE_RX_RING){
+            i2c_slave_ring_consume(&i2c->rx_ring, len);
+        } else {
+            vRingbufferReturnItem(i2c->rx_ring_buf, item);
+        }
+        return;
+    }
+    i2c_slave_pool_put(i2c, data);
+}
+
+static size_t i2c_slave_tx_produce(i2c_slave_struct_t * i2c, uint8_t * buf, size_t len)
+{
+    size_t n = i2c->tx_producer(i2c->num, buf, len, i2c->tx_stream_offset, i2c->tx_producer_arg);
+    if(n == 0 || n > len){
+        i2c->tx_stream_active = false;
+        if(i2c->pec_enabled){
+            //close the stream with its PEC
+            buf[0] = i2c->tx_pec;
+            return 1;
+        }
+        return 0;
+    }
+    i2c->tx_stream_offset += n;
+    if(i2c->pec_enabled){
+        i2c->tx_pec = smbus_pec_update(i2c->tx_pec, buf, n);
+    }
+    return n;
+}
+
+static void i2c_slave_tx_stream_fill(i2c_slave_struct_t * i2c)
+{
+    uint8_t * span = NULL;
+    uint32_t n = 0;
+    if(i2c->tx_stream_active && !i2c_slave_ring_count(&i2c->tx_ring)){
+        //nothing queued ahead, the FIFO can take the stream directly
+        uint8_t chunk[SOC_I2C_FIFO_LEN];
+        uint32_t fifo_free = 0;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+        i2c_ll_get_txfifo_len(i2c->dev, &fifo_free);
+#else
+        fifo_free = i2c_ll_get_txfifo_len(i2c->dev);
 #endif
+        if(fifo_free){
+            n = i2c_slave_tx_produce(i2c, chunk, fifo_free);
+            i2c_ll_write_txfifo(i2c->dev, chunk, n);
+            i2c_slave_tx_loaded(i2c, chunk, n);
+        }
+    }
+    //produce straight into the free spans of tx_ring, the ISR drains it as the FIFO empties
+    while(i2c->tx_stream_active && (n = i2c_slave_ring_reserve(&i2c->tx_ring, &span)) > 0){
+        i2c_slave_ring_commit(&i2c->tx_ring, i2c_slave_tx_produce(i2c, span, n));
+    }
+    if(i2c_slave_ring_count(&i2c->tx_ring)){
+        i2c_ll_slave_enable_tx_it(i2c->dev);
+    }
 }
 
-static void i2c_slave_task(void *pv_args)
+static void i2c_slave_trans_info(const i2c_slave_queue_event_t * event, i2c_slave_trans_info_t * info)
+{
+    //widen the ISR time, the queuing delay is far below the 71 minutes wrap of the low bits
+    info->pec = (event->event == I2C_SLAVE_EVT_RX) ? (i2c_slave_pec_status_t)event->pec : I2C_SLAVE_PEC_NONE;
+    info->dispatch_time_us = esp_timer_get_time();
+    info->isr_time_us = info->dispatch_time_us - (uint32_t)((uint32_t)info->dispatch_time_us - event->time_us);
+}
+
+static void i2c_slave_dispatch_event(i2c_slave_struct_t * i2c, const i2c_slave_queue_event_t * event)
 {
-    i2c_slave_struct_t * i2c = (i2c_slave_struct_t *)pv_args;
-    i2c_slave_queue_event_t event;
     size_t len = 0;
     bool stop = false;
     uint8_t * data = NULL;
-    for(;;){
-        if(xQueueReceive(i2c->event_queue, &event, portMAX_DELAY) == pdTRUE){
-            // Write
-            if(event.event == I2C_SLAVE_EVT_RX){
-                len = event.param;
-                stop = event.stop;
-                data = (len > 0)?(uint8_t*)malloc(len):NULL;
-
-                if(len && data == NULL){
-                    ESP_LOGE(TAG, "Malloc (%u) Failed", len);
-                }
-                len = i2c_slave_read_rx(i2c, data, len);
-                if(i2c->receive_callback){
-                #ifdef DEBUG_MODE
-                    gpio_set_level(DEBUG_IO, 1);
-                #endif
-                    i2c->receive_callback(i2c->num, data, len, stop, i2c->arg);
-                #ifdef DEBUG_MODE
-                    gpio_set_level(DEBUG_IO, 0);
-                #endif
-                }
-                free(data);
-
-            // Read
-            } else if(event.event == I2C_SLAVE_EVT_TX){
-                if(i2c->request_callback) {
-                    len = event.param;
-                    data = (len > 0)?(uint8_t*)malloc(len):NULL;
-                    len = i2c_slave_read_rx(i2c, data, len);
-                #ifdef DEBUG_MODE
-                    gpio_set_level(DEBUG_IO2, 1);
-                #endif
+    void * item = NULL;
+    i2c_slave_trans_info_t info;
+    i2c_slave_trans_info(event, &info);
+    // Write
+    if(event->event == I2C_SLAVE_EVT_RX || event->event == I2C_SLAVE_EVT_RX_CHUNK){
+        len = event->param;
+        stop = event->stop;
+        data = i2c_slave_take_rx(i2c, &len, &item);
+        if(i2c->rx_chunk_callback){
+            bool end = (event->event == I2C_SLAVE_EVT_RX);
+            if(data || !event->param){
+                i2c->rx_chunk_callback(i2c->num, data, len, i2c->rx_stream_offset, end, info.pec, i2c->rx_chunk_arg);
+            }
+            i2c->rx_stream_offset = end ? 0 : (i2c->rx_stream_offset + len);
+        } else if((i2c->receive_callback || i2c->receive_callback_ex) && (data || !event->param)){
+            //hide the PEC byte from the callbacks
+            size_t cb_len = (info.pec != I2C_SLAVE_PEC_NONE && len) ? len - 1 : len;
+        #ifdef DEBUG_MODE
+            gpio_set_level(DEBUG_IO, 1);
+        #endif
+            if(i2c->receive_callback_ex){
+                i2c->receive_callback_ex(i2c->num, data, cb_len, stop, &info, i2c->arg);
+            } else {
+                i2c->receive_callback(i2c->num, data, cb_len, stop, i2c->arg);
+            }
+        #ifdef DEBUG_MODE
+            gpio_set_level(DEBUG_IO, 0);
+        #endif
+        }
+        i2c_slave_return_rx(i2c, data, len, item);
+
+    // Read
+    } else if(event->event == I2C_SLAVE_EVT_TX){
+        if(i2c->request_callback || i2c->request_callback_ex) {
+            len = event->param;
+            data = i2c_slave_take_rx(i2c, &len, &item);
+            if(data || !event->param){
+            #ifdef DEBUG_MODE
+                gpio_set_level(DEBUG_IO2, 1);
+            #endif
+                if(i2c->request_callback_ex){
+                    i2c->request_callback_ex(i2c->num, data, len, &info, i2c->arg);
+                } else {
                     i2c->request_callback(i2c->num, data, len, i2c->arg);
-                #ifdef DEBUG_MODE
-                    gpio_set_level(DEBUG_IO2, 0);
-                #endif
-                    free(data);
                 }
-                i2c_ll_stretch_clr(i2c->dev);
+            #ifdef DEBUG_MODE
+                gpio_set_level(DEBUG_IO2, 0);
+            #endif
+            }
+            i2c_slave_return_rx(i2c, data, len, item);
+        }
+        if(i2c->tx_producer){
+            //stream the rest of the read, after what request_callback has written
+            i2c->tx_stream_offset = 0;
+            i2c->tx_stream_active = true;
+            i2c_slave_tx_stream_fill(i2c);
+        } else if(i2c->pec_enabled){
+            //close the response written by request_callback
+            i2c_slave_tx_append(i2c, &i2c->tx_pec, 1);
+        }
+        i2c_slave_stretch_release(i2c);
+
+    // Streaming read drained below the low water mark
+    } else if(event->event == I2C_SLAVE_EVT_TX_REFILL){
+        __atomic_store_n(&i2c->tx_refill_pending, false, __ATOMIC_SEQ_CST);
+        i2c_slave_tx_stream_fill(i2c);
+        if(__atomic_exchange_n(&i2c->tx_refill_stretched, false, __ATOMIC_SEQ_CST)){
+            i2c_ll_stretch_clr(i2c->dev);
+        }
+
+    // Command already answered from the ISR
+    } else if(event->event == I2C_SLAVE_EVT_SKIP){
+        i2c_slave_read_rx(i2c, NULL, event->param);
+
+    // Register map written by the master
+    } else if(event->event == I2C_SLAVE_EVT_REGMAP){
+        portENTER_CRITICAL(&i2c->spinlock);
+        uint32_t lo = i2c->regmap_dirty_lo;
+        uint32_t hi = i2c->regmap_dirty_hi;
+        i2c->regmap_dirty_lo = i2c->regmap_size;
+        i2c->regmap_dirty_hi = 0;
+        i2c->regmap_pending = false;
+        portEXIT_CRITICAL(&i2c->spinlock);
+        if(i2c->regmap_callback && hi > lo){
+            i2c->regmap_callback(i2c->num, lo, hi - lo, i2c->regmap_arg);
+        }
+    }
+}
+
+// wait up to ticks for the next event when there is no worker, the caller becomes the notified task
+static bool i2c_slave_next_event(i2c_slave_struct_t * i2c, i2c_slave_queue_event_t * event, TickType_t ticks)
+{
+    if(i2c->event_ring.size){
+        i2c->event_task = xTaskGetCurrentTaskHandle();
+        if(i2c_slave_ring_read(&i2c->event_ring, (uint8_t *)event, sizeof(*event)) == sizeof(*event)){
+            return true;
+        }
+        ulTaskNotifyTake(pdTRUE, ticks);
+        return i2c_slave_ring_read(&i2c->event_ring, (uint8_t *)event, sizeof(*event)) == sizeof(*event);
+    }
+    return xQueueReceive(i2c->event_queue, event, ticks) == pdTRUE;
+}
+
+static void i2c_slave_task(void *pv_args)
+{
+    i2c_slave_struct_t * i2c = (i2c_slave_struct_t *)pv_args;
+    i2c_slave_queue_event_t event;
+    for(;;){
+        if(i2c->event_ring.size){
+            //one notification may stand for many events, drain them all
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            i2c->stats.worker_wakeups++;
+            while(i2c_slave_ring_read(&i2c->event_ring, (uint8_t *)&event, sizeof(event)) == sizeof(event)){
+                i2c_slave_dispatch_event(i2c, &event);
             }
+        } else if(xQueueReceive(i2c->event_queue, &event, portMAX_DELAY) == pdTRUE){
+            i2c->stats.worker_wakeups++;
+            do {
+                i2c_slave_dispatch_event(i2c, &event);
+            } while(xQueueReceive(i2c->event_queue, &event, 0) == pdTRUE);
         }
     }
     vTaskDelete(NULL);
 }
+
+static void i2c_slave_poll_task(void *pv_args)
+{
+    i2c_slave_struct_t * i2c = (i2c_slave_struct_t *)pv_args;
+    //wait for i2cSlaveInitEx to finish the peripheral setup
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for(;;){
+        //the interrupt enable mask still gates the status bits, spin on them instead of taking the interrupt
+        i2c_slave_service(i2c);
+    }
+    vTaskDelete(NULL);
+}
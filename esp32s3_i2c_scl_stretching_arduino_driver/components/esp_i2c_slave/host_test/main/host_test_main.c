@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp32-hal-i2c-slave.h"
+#include "smbus_pec.h"
+#include "i2c_slave_sim.h"
+
+#define TEST_PORT       0
+#define TEST_ADDR       0x5A
+#define TEST_BUF_LEN    64
+
+static uint32_t failures;
+
+#define TEST_CHECK(cond, ...) do {  \
+    if(!(cond)){                    \
+        printf("FAIL %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);        \
+        printf("\n");               \
+        failures++;                 \
+    }                               \
+} while(0)
+
+// SMBus read word of an MLX90614: addr|W, command 0x07, addr|R, 0xD2 0x3A, PEC 0x30
+static const uint8_t pec_cmd = 0x07;
+static const uint8_t pec_word[2] = { 0xD2, 0x3A };
+static const uint8_t pec_word_pec = 0x30;
+
+static void test_pec_table(void)
+{
+    for(int pec = 0; pec < 256; pec++){
+        for(int b = 0; b < 256; b++){
+            uint8_t byte = (uint8_t)b;
+            uint8_t ref = smbus_pec_update_ref((uint8_t)pec, &byte, 1);
+            TEST_CHECK(smbus_pec_update((uint8_t)pec, &byte, 1) == ref, "update pec %02x byte %02x", pec, b);
+            TEST_CHECK(smbus_pec_byte((uint8_t)pec, byte) == ref, "byte pec %02x byte %02x", pec, b);
+        }
+    }
+    const uint8_t frame[] = { TEST_ADDR << 1, pec_cmd, TEST_ADDR << 1 | 1, pec_word[0], pec_word[1] };
+    TEST_CHECK(smbus_pec_update_ref(SMBUS_PEC_INIT, frame, sizeof(frame)) == pec_word_pec, "reference read word vector");
+    TEST_CHECK(smbus_pec_update(SMBUS_PEC_INIT, frame, sizeof(frame)) == pec_word_pec, "read word vector");
+    //the PEC byte brings the CRC of the whole frame to 0
+    uint8_t pec = smbus_pec_update(SMBUS_PEC_INIT, frame, sizeof(frame));
+    TEST_CHECK(smbus_pec_byte(pec, pec_word_pec) == 0, "frame with PEC");
+}
+
+static volatile i2c_slave_pec_status_t rx_pec;
+static volatile size_t rx_len;
+
+static void test_on_request(uint8_t num, uint8_t *cmd, uint8_t cmd_len, const i2c_slave_trans_info_t * info, void * arg)
+{
+    i2cSlaveWrite(num, pec_word, sizeof(pec_word), 0);
+}
+
+static void test_on_receive(uint8_t num, uint8_t * data, size_t len, bool stop, const i2c_slave_trans_info_t * info, void * arg)
+{
+    rx_len = len;
+    rx_pec = info->pec;
+}
+
+// the driver against the simulated peripheral, with the 1 byte command below the RX watermark
+static void test_pec_driver(void)
+{
+    i2cSlaveSetPec(TEST_PORT, true);
+    i2cSlaveAttachCallbacksEx(TEST_PORT, test_on_request, test_on_receive, NULL);
+    i2c_slave_config_t config = I2C_SLAVE_CONFIG_DEFAULT(0, 1, TEST_ADDR);
+    config.rx_len = TEST_BUF_LEN;
+    config.tx_len = TEST_BUF_LEN;
+    esp_err_t err = i2cSlaveInitEx(TEST_PORT, &config);
+    TEST_CHECK(err == ESP_OK, "init %d", err);
+    if(err != ESP_OK){
+        return;
+    }
+
+    //read word: the appended PEC covers the command write before the repeated START
+    uint8_t rd[3] = { 0 };
+    err = i2c_slave_sim_master_transfer(TEST_PORT, TEST_ADDR, &pec_cmd, 1, rd, sizeof(rd));
+    TEST_CHECK(err == ESP_OK, "read word %d", err);
+    TEST_CHECK(!memcmp(rd, pec_word, sizeof(pec_word)), "read word data %02x %02x", rd[0], rd[1]);
+    TEST_CHECK(rd[2] == pec_word_pec, "read word PEC %02x, expected %02x", rd[2], pec_word_pec);
+
+    //write word, with a good and a bad PEC
+    uint8_t wr[4] = { pec_cmd, pec_word[0], pec_word[1], 0 };
+    wr[3] = smbus_pec_byte(SMBUS_PEC_INIT, TEST_ADDR << 1);
+    wr[3] = smbus_pec_update(wr[3], wr, 3);
+    for(int bad = 0; bad < 2; bad++){
+        rx_pec = I2C_SLAVE_PEC_NONE;
+        rx_len = 0;
+        wr[3] ^= bad;
+        err = i2c_slave_sim_master_transfer(TEST_PORT, TEST_ADDR, wr, sizeof(wr), NULL, 0);
+        vTaskDelay(pdMS_TO_TICKS(10));
+        TEST_CHECK(err == ESP_OK, "write word %d", err);
+        TEST_CHECK(rx_len == 3, "write word length %u", (unsigned)rx_len);
+        TEST_CHECK(rx_pec == (bad ? I2C_SLAVE_PEC_FAIL : I2C_SLAVE_PEC_OK), "write word PEC status %d", rx_pec);
+    }
+    i2cSlaveDeinit(TEST_PORT);
+}
+
+void app_main(void)
+{
+    test_pec_table();
+    test_pec_driver();
+    printf("%s, %u failures\n", failures ? "FAILED" : "PASSED", (unsigned)failures);
+    //non zero exit status for CI
+    exit(failures ? 1 : 0);
+}
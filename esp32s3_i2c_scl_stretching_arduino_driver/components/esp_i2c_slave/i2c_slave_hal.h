@@ -0,0 +1,193 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Everything the driver needs from the peripheral, the interrupt allocator and the GPIO matrix.
+// On the linux target the same names are backed by the simulated peripheral in sim/, so the ISR
+// and worker code of esp32-hal-i2c-slave.c run unchanged on a PC.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_idf_version.h"
+
+typedef enum {
+    I2C_STRETCH_CAUSE_MASTER_READ,
+    I2C_STRETCH_CAUSE_TX_FIFO_EMPTY,
+    I2C_STRETCH_CAUSE_RX_FIFO_FULL,
+    I2C_STRETCH_CAUSE_MAX
+} i2c_stretch_cause_t;
+
+#if CONFIG_IDF_TARGET_LINUX
+#include "sim/i2c_slave_sim_hal.h"
+#else
+
+#include "soc/soc_caps.h"
+#include "rom/gpio.h"
+#include "soc/gpio_sig_map.h"
+#include "hal/gpio_types.h"
+#include "driver/gpio.h"
+#include "esp_intr_alloc.h"
+#include "soc/i2c_reg.h"
+#include "soc/i2c_struct.h"
+#include "hal/i2c_ll.h"
+#include "hal/clk_gate_ll.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_task_wdt.h"
+#if !CONFIG_FREERTOS_UNICORE
+#include "esp_ipc.h"
+#endif
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "esp_cpu.h"
+#define i2c_slave_cycles() esp_cpu_get_cycle_count()
+#else
+#include "hal/cpu_hal.h"
+#define i2c_slave_cycles() cpu_hal_get_cycle_count()
+#endif
+
+// CCOUNT is per core, only compare two readings taken on the same one
+#define i2c_slave_cycles_per_us() esp_rom_get_cpu_ticks_per_us()
+#define i2c_slave_core_id() xPortGetCoreID()
+
+#define I2C_SLAVE_HAL_MULTICORE (!CONFIG_FREERTOS_UNICORE)
+
+#if SOC_I2C_NUM > 1
+#define I2C_SCL_IDX(p)  ((p==0)?I2CEXT0_SCL_OUT_IDX:((p==1)?I2CEXT1_SCL_OUT_IDX:0))
+#define I2C_SDA_IDX(p) ((p==0)?I2CEXT0_SDA_OUT_IDX:((p==1)?I2CEXT1_SDA_OUT_IDX:0))
+#else
+#define I2C_SCL_IDX(p)  I2CEXT0_SCL_OUT_IDX
+#define I2C_SDA_IDX(p) I2CEXT0_SDA_OUT_IDX
+#endif
+
+#if CONFIG_IDF_TARGET_ESP32
+    #define I2C_TXFIFO_WM_INT_ENA    I2C_TXFIFO_EMPTY_INT_ENA
+    #define I2C_RXFIFO_WM_INT_ENA     I2C_RXFIFO_FULL_INT_ENA
+#endif
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#define i2c_ll_set_filter i2c_ll_master_set_filter
+#define i2c_ll_cal_bus_clk i2c_ll_master_cal_bus_clk
+#define i2c_ll_set_bus_timing i2c_ll_master_set_bus_timing
+#define i2c_ll_set_fifo_mode i2c_ll_slave_set_fifo_mode
+#define i2c_ll_clr_intsts_mask i2c_ll_clear_intr_mask 
+#define i2c_clk_cal_t i2c_hal_clk_config_t
+#define I2C_SCLK_APB SOC_MOD_CLK_APB
+#define I2C_SCLK_XTAL SOC_MOD_CLK_XTAL
+#endif
+
+//-------------------------------------- HAL_LL (Missing Functions) ------------------------------------------------
+static inline i2c_stretch_cause_t i2c_ll_stretch_cause(i2c_dev_t *hw)
+{
+#if CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32S3
+    return hw->sr.stretch_cause;
+#elif CONFIG_IDF_TARGET_ESP32S2
+    return hw->status_reg.stretch_cause;
+#else
+    return I2C_STRETCH_CAUSE_MAX;
+#endif
+}
+
+static inline void i2c_ll_set_stretch(i2c_dev_t *hw, uint16_t time)
+{
+#ifndef CONFIG_IDF_TARGET_ESP32
+    typeof(hw->scl_stretch_conf) scl_stretch_conf;
+    scl_stretch_conf.val = 0;
+    scl_stretch_conf.slave_scl_stretch_en = (time > 0);
+    scl_stretch_conf.stretch_protect_num = time;
+    scl_stretch_conf.slave_scl_stretch_clr = 1;
+    hw->scl_stretch_conf.val = scl_stretch_conf.val;
+    if(time > 0){
+        //enable interrupt
+        hw->int_ena.val |= I2C_SLAVE_STRETCH_INT_ENA;
+    } else {
+        //disable interrupt
+        hw->int_ena.val &= (~I2C_SLAVE_STRETCH_INT_ENA);
+    }
+#endif
+}
+
+static inline void i2c_ll_stretch_clr(i2c_dev_t *hw)
+{
+#ifndef CONFIG_IDF_TARGET_ESP32
+    hw->scl_stretch_conf.slave_scl_stretch_clr = 1;
+#endif
+}
+
+static inline bool i2c_ll_slave_addressed(i2c_dev_t *hw)
+{
+#if CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32C6 || CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32H2
+    return hw->sr.slave_addressed;
+#else
+    return hw->status_reg.slave_addressed;
+#endif
+}
+
+static inline bool i2c_ll_slave_rw(i2c_dev_t *hw)//not exposed by hal_ll
+{
+#if CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32C6 || CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32H2
+    return hw->sr.slave_rw;
+#else
+    return hw->status_reg.slave_rw;
+#endif
+}
+
+static inline void i2c_slave_hal_enable_periph(uint8_t num)
+{
+    if (num == 0) {
+        periph_ll_enable_clk_clear_rst(PERIPH_I2C0_MODULE);
+#if SOC_I2C_NUM > 1
+    } else {
+        periph_ll_enable_clk_clear_rst(PERIPH_I2C1_MODULE);
+#endif
+    }
+}
+
+// the polled mode worker never blocks, the idle task of its core is off the task watchdog meanwhile.
+// Returns true when it was subscribed and has to be put back
+static inline bool i2c_slave_hal_idle_wdt_remove(int core)
+{
+    return esp_task_wdt_delete(xTaskGetIdleTaskHandleForCPU(core)) == ESP_OK;
+}
+
+static inline void i2c_slave_hal_idle_wdt_restore(int core)
+{
+    esp_task_wdt_add(xTaskGetIdleTaskHandleForCPU(core));
+}
+
+static inline int i2c_slave_hal_intr_source(uint8_t num)
+{
+#if SOC_I2C_NUM > 1
+    if(num == 1){
+        return ETS_I2C_EXT1_INTR_SOURCE;
+    }
+#endif
+    return ETS_I2C_EXT0_INTR_SOURCE;
+}
+
+static inline void i2c_slave_hal_set_bus_clk(i2c_dev_t *hw, uint32_t clk_speed)
+{
+    i2c_clk_cal_t clk_cal;
+#if SOC_I2C_SUPPORT_APB
+    i2c_ll_cal_bus_clk(APB_CLK_FREQ, clk_speed, &clk_cal);
+    i2c_ll_set_source_clk(hw, I2C_SCLK_APB);            /*!< I2C source clock from APB, 80M*/
+#elif SOC_I2C_SUPPORT_XTAL
+    i2c_ll_cal_bus_clk(XTAL_CLK_FREQ, clk_speed, &clk_cal);
+    i2c_ll_set_source_clk(hw, I2C_SCLK_XTAL);           /*!< I2C source clock from XTAL, 40M */
+#endif
+    i2c_ll_set_bus_timing(hw, &clk_cal);
+}
+
+#endif // CONFIG_IDF_TARGET_LINUX
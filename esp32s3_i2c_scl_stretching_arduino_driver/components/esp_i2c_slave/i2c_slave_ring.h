@@ -0,0 +1,179 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// always inlined, so the ring runs from IRAM together with an IRAM-resident ISR
+#define I2C_SLAVE_RING_FN static inline __attribute__((always_inline))
+
+// Lock-free single-producer/single-consumer byte ring.
+// head is only written by the producer and tail only by the consumer,
+// so one side may run in an ISR and the other in a task without any lock.
+// i2c_slave_ring_flush is the exception, see there.
+// One byte of buf is kept free to tell a full ring from an empty one.
+typedef struct {
+    uint8_t * buf;
+    uint32_t size;
+    uint32_t head;
+    uint32_t tail;
+} i2c_slave_ring_t;
+
+I2C_SLAVE_RING_FN void i2c_slave_ring_init(i2c_slave_ring_t * r, uint8_t * buf, uint32_t size)
+{
+    r->buf = buf;
+    r->size = size;
+    r->head = 0;
+    r->tail = 0;
+}
+
+I2C_SLAVE_RING_FN uint32_t i2c_slave_ring_count(const i2c_slave_ring_t * r)
+{
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    return (head >= tail) ? (head - tail) : (r->size - tail + head);
+}
+
+I2C_SLAVE_RING_FN uint32_t i2c_slave_ring_space(const i2c_slave_ring_t * r)
+{
+    return r->size ? (r->size - 1 - i2c_slave_ring_count(r)) : 0;
+}
+
+//-------------------------------------- Producer ---------------------------------------------------------------------
+
+// copy up to len bytes into the ring and publish them at once, returns the number of bytes written
+I2C_SLAVE_RING_FN uint32_t i2c_slave_ring_write(i2c_slave_ring_t * r, const uint8_t * data, uint32_t len)
+{
+    uint32_t space = i2c_slave_ring_space(r);
+    uint32_t head = r->head;
+    if(len > space){
+        len = space;
+    }
+    uint32_t first = r->size - head;
+    if(first > len){
+        first = len;
+    }
+    memcpy(r->buf + head, data, first);
+    memcpy(r->buf, data + first, len - first);
+    head += len;
+    if(head >= r->size){
+        head -= r->size;
+    }
+    __atomic_store_n(&r->head, head, __ATOMIC_RELEASE);
+    return len;
+}
+
+// contiguous writable span at head, returns its length (0 if full)
+I2C_SLAVE_RING_FN uint32_t i2c_slave_ring_reserve(const i2c_slave_ring_t * r, uint8_t ** span)
+{
+    uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    uint32_t head = r->head;
+    *span = r->buf + head;
+    if(head >= tail){
+        return r->size - head - (tail == 0);
+    }
+    return tail - head - 1;
+}
+
+// publish len bytes written into the span returned by i2c_slave_ring_reserve
+I2C_SLAVE_RING_FN void i2c_slave_ring_commit(i2c_slave_ring_t * r, uint32_t len)
+{
+    uint32_t head = r->head + len;
+    if(head >= r->size){
+        head -= r->size;
+    }
+    __atomic_store_n(&r->head, head, __ATOMIC_RELEASE);
+}
+
+// copy up to len bytes to offset bytes past head without publishing them, returns the number of bytes written.
+// i2c_slave_ring_commit publishes everything staged so far at once
+I2C_SLAVE_RING_FN uint32_t i2c_slave_ring_stage(i2c_slave_ring_t * r, uint32_t offset, const uint8_t * data, uint32_t len)
+{
+    uint32_t space = i2c_slave_ring_space(r);
+    if(offset >= space){
+        return 0;
+    }
+    if(len > space - offset){
+        len = space - offset;
+    }
+    uint32_t pos = r->head + offset;
+    if(pos >= r->size){
+        pos -= r->size;
+    }
+    uint32_t first = r->size - pos;
+    if(first > len){
+        first = len;
+    }
+    memcpy(r->buf + pos, data, first);
+    memcpy(r->buf, data + first, len - first);
+    return len;
+}
+
+// take back the last len published bytes, only valid while the consumer is known not to read them
+I2C_SLAVE_RING_FN void i2c_slave_ring_uncommit(i2c_slave_ring_t * r, uint32_t len)
+{
+    uint32_t head = (r->head >= len) ? (r->head - len) : (r->head + r->size - len);
+    __atomic_store_n(&r->head, head, __ATOMIC_RELEASE);
+}
+
+//-------------------------------------- Consumer ---------------------------------------------------------------------
+
+// contiguous readable span at tail, returns its length (0 if empty)
+I2C_SLAVE_RING_FN uint32_t i2c_slave_ring_peek(const i2c_slave_ring_t * r, uint8_t ** span)
+{
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = r->tail;
+    *span = r->buf + tail;
+    return (head >= tail) ? (head - tail) : (r->size - tail);
+}
+
+// copy up to len bytes out of the ring and release them at once, returns the number of bytes read
+I2C_SLAVE_RING_FN uint32_t i2c_slave_ring_read(i2c_slave_ring_t * r, uint8_t * data, uint32_t len)
+{
+    uint32_t count = i2c_slave_ring_count(r);
+    uint32_t tail = r->tail;
+    if(len > count){
+        len = count;
+    }
+    uint32_t first = r->size - tail;
+    if(first > len){
+        first = len;
+    }
+    memcpy(data, r->buf + tail, first);
+    memcpy(data + first, r->buf, len - first);
+    tail += len;
+    if(tail >= r->size){
+        tail -= r->size;
+    }
+    __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    return len;
+}
+
+I2C_SLAVE_RING_FN void i2c_slave_ring_consume(i2c_slave_ring_t * r, uint32_t len)
+{
+    uint32_t tail = r->tail + len;
+    if(tail >= r->size){
+        tail -= r->size;
+    }
+    __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+}
+
+// drop everything the producer has published so far. It moves tail, so it is a consumer operation:
+// a producer calling it must hold off the consumer, e.g. with a lock the consumer takes as well
+I2C_SLAVE_RING_FN void i2c_slave_ring_flush(i2c_slave_ring_t * r)
+{
+    __atomic_store_n(&r->tail, __atomic_load_n(&r->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
@@ -14,7 +14,12 @@
 
 #pragma once
 
+#include "sdkconfig.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include "i2c_slave_sim.h"
+#else
 #include "soc/soc_caps.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,16 +27,244 @@ extern "C" {
 
 #include "stdint.h"
 #include "stddef.h"
+#include "stdbool.h"
+#include "sdkconfig.h"
 #include "esp_err.h"
 
 typedef void (*i2c_slave_request_cb_t) (uint8_t num, uint8_t *cmd, uint8_t cmd_len, void * arg);
 typedef void (*i2c_slave_receive_cb_t) (uint8_t num, uint8_t * data, size_t len, bool stop, void * arg);
 esp_err_t i2cSlaveAttachCallbacks(uint8_t num, i2c_slave_request_cb_t request_callback, i2c_slave_receive_cb_t receive_callback, void * arg);
 
+typedef enum {
+    I2C_SLAVE_PEC_NONE, // PEC disabled, or the write is too short to carry one
+    I2C_SLAVE_PEC_OK,   // the last byte of the write matched, it is not passed to the callback
+    I2C_SLAVE_PEC_FAIL, // the last byte of the write did not match, it is not passed to the callback
+} i2c_slave_pec_status_t;
+
+// Extended callbacks, same as above plus the bus timing of the transaction.
+// Times are esp_timer_get_time() microseconds, comparable across cores and with other subsystems.
+typedef struct {
+    int64_t isr_time_us;      // STOP or repeated START seen by the ISR (receive), master read stretch (request)
+    int64_t dispatch_time_us; // the worker task picked the event up, minus isr_time_us gives the queuing delay
+    i2c_slave_pec_status_t pec; // SMBus PEC check of a master write, see i2cSlaveSetPec
+} i2c_slave_trans_info_t;
+typedef void (*i2c_slave_request_ex_cb_t) (uint8_t num, uint8_t *cmd, uint8_t cmd_len, const i2c_slave_trans_info_t * info, void * arg);
+typedef void (*i2c_slave_receive_ex_cb_t) (uint8_t num, uint8_t * data, size_t len, bool stop, const i2c_slave_trans_info_t * info, void * arg);
+// replaces the callbacks set by i2cSlaveAttachCallbacks, and the other way around
+esp_err_t i2cSlaveAttachCallbacksEx(uint8_t num, i2c_slave_request_ex_cb_t request_callback, i2c_slave_receive_ex_cb_t receive_callback, void * arg);
+
+// Optional fast path for master reads, called from i2c_slave_isr_handler while SCL is stretched.
+// Answer with i2cSlaveWriteFromISR and return true to release SCL immediately, or return false
+// to hand the request over to request_callback in the worker task.
+// Commands longer than I2C_SLAVE_ISR_CMD_MAX_LEN always take the worker task path.
+#define I2C_SLAVE_ISR_CMD_MAX_LEN 16
+typedef bool (*i2c_slave_isr_request_cb_t) (uint8_t num, const uint8_t *cmd, uint8_t cmd_len, void * arg);
+esp_err_t i2cSlaveAttachIsrRequestCallback(uint8_t num, i2c_slave_isr_request_cb_t isr_request_callback, void * arg);
+
+// Register map mode: the first byte of a master write sets the register pointer, the following
+// bytes are stored at regs[pointer++]. Master reads are served from regs[pointer++] by the ISR.
+// The pointer wraps at size (at most 256). Written ranges are coalesced and reported to
+// changed_callback from the worker task. Request and receive callbacks are not used.
+// Must be attached before i2cSlaveInit, regs must stay valid until i2cSlaveDeinit.
+typedef void (*i2c_slave_regmap_cb_t) (uint8_t num, size_t offset, size_t len, void * arg);
+esp_err_t i2cSlaveAttachRegisterMap(uint8_t num, uint8_t * regs, size_t size, i2c_slave_regmap_cb_t changed_callback, void * arg);
+// access the register map from the application without racing the ISR
+esp_err_t i2cSlaveRegisterMapWrite(uint8_t num, size_t offset, const uint8_t * data, size_t len);
+esp_err_t i2cSlaveRegisterMapRead(uint8_t num, size_t offset, uint8_t * data, size_t len);
+
+// Pre-staged responses: count slots (at most 256) of up to max_len bytes, indexed by the first
+// command byte. A master read whose command has a published response is answered by the ISR,
+// otherwise it falls back to the ISR request callback, then to request_callback.
+// Must be set before i2cSlaveInit.
+esp_err_t i2cSlaveSetResponseSlots(uint8_t num, size_t count, size_t max_len);
+// Publish the response to cmd (len 0 clears it). Double buffered, never blocks the ISR.
+esp_err_t i2cSlavePublishResponse(uint8_t num, uint8_t cmd, const uint8_t * data, size_t len);
+
+// Streaming master reads: after request_callback returns, the worker task calls producer to fill
+// buf with up to len bytes of the read, offset bytes into it. Return the bytes written, 0 ends the
+// stream. It is called again each time the queued bytes drop below low_water (0 for tx_len / 2),
+// so only what the master clocks out is produced, with tx_len bytes of buffering.
+// Must be attached before i2cSlaveInit.
+typedef size_t (*i2c_slave_tx_producer_cb_t) (uint8_t num, uint8_t * buf, size_t len, size_t offset, void * arg);
+esp_err_t i2cSlaveAttachTxProducer(uint8_t num, i2c_slave_tx_producer_cb_t producer, size_t low_water, void * arg);
+
+// Streaming master writes: every chunk_len bytes (rounded up to the next RX FIFO read) the worker task
+// calls chunk_callback with the next part of the write, offset bytes into it, instead of receive_callback.
+// The last part, possibly empty, comes with end set at STOP or repeated START, and with the PEC check of
+// the whole write (I2C_SLAVE_PEC_NONE on the other parts). The PEC byte stays in the data, as the last
+// byte of the write. rx_len only has to hold chunk_len + SOC_I2C_FIFO_LEN bytes, whatever the write length.
+// Must be attached before i2cSlaveInit.
+typedef void (*i2c_slave_rx_chunk_cb_t) (uint8_t num, const uint8_t * data, size_t len, size_t offset, bool end, i2c_slave_pec_status_t pec, void * arg);
+esp_err_t i2cSlaveAttachRxChunkCallback(uint8_t num, i2c_slave_rx_chunk_cb_t chunk_callback, size_t chunk_len, void * arg);
+
+// SMBus Packet Error Checking: the ISR updates a CRC-8 as bytes move through the FIFOs. On master
+// writes the last byte is checked and stripped, the result is in i2c_slave_trans_info_t.pec. On master
+// reads the PEC is appended after the response (or after the end of a TX producer stream).
+// Not used in register map mode. Must be called before i2cSlaveInit.
+esp_err_t i2cSlaveSetPec(uint8_t num, bool enable);
+
+typedef enum {
+    I2C_SLAVE_RX_DELIVERY_COPY,      // each transaction is copied into a pool buffer before the callback (default)
+    I2C_SLAVE_RX_DELIVERY_ZERO_COPY, // the callback borrows the RX ring buffer memory, valid only until it returns
+} i2c_slave_rx_delivery_t;
+// Zero copy lends one span: a transaction that wraps around the end of the RX ring is still joined in
+// a pool buffer, so it costs one copy like I2C_SLAVE_RX_DELIVERY_COPY. I2C_SLAVE_RX_QUEUE always copies.
+// must be called before i2cSlaveInit
+esp_err_t i2cSlaveSetRxDelivery(uint8_t num, i2c_slave_rx_delivery_t delivery);
+typedef enum {
+    I2C_SLAVE_RX_RINGBUF, // FreeRTOS byte ring buffer, one xRingbufferSendFromISR per RX FIFO read (default)
+    I2C_SLAVE_RX_QUEUE,   // FreeRTOS queue, one xQueueSendFromISR per byte
+    I2C_SLAVE_RX_RING,    // driver owned lock-free ring, the ISR reads the RX FIFO straight into it
+} i2c_slave_rx_mode_t;
+// must be called before i2cSlaveInit
+esp_err_t i2cSlaveSetRxMode(uint8_t num, i2c_slave_rx_mode_t mode);
+
+// stretch latency histogram, bin 0 is < 1us, bin n is [2^(n-1), 2^n) us, the last bin also holds everything above
+#define I2C_SLAVE_STRETCH_HIST_BINS 16
+// RX/TX FIFO watermarks: the RX interrupt fires once the RX FIFO holds rx_full_thr bytes, the TX one
+// once the TX FIFO holds no more than tx_empty_thr bytes (1 .. SOC_I2C_FIFO_LEN - 1, 0 for the
+// frequency based default). With adaptive set the ISR retunes both after each transaction longer than
+// the FIFO: a FIFO full/empty stretch moves the watermark to interrupt earlier, a run of clean
+// transactions moves it back to fewer interrupts per byte. Must be called before i2cSlaveInit.
+esp_err_t i2cSlaveSetFifoThresholds(uint8_t num, uint8_t rx_full_thr, uint8_t tx_empty_thr, bool adaptive);
+// watermarks in use
+esp_err_t i2cSlaveGetFifoThresholds(uint8_t num, uint8_t * rx_full_thr, uint8_t * tx_empty_thr);
+
+typedef enum {
+    I2C_SLAVE_EVENT_QUEUE,  // FreeRTOS queue, one xQueueReceive per event (default)
+    I2C_SLAVE_EVENT_NOTIFY, // lock-free ISR event ring plus a task notification, the worker drains every pending event per wake-up
+} i2c_slave_event_mode_t;
+// must be called before i2cSlaveInit, depth is the number of pending events (0 for the default of 16)
+esp_err_t i2cSlaveSetEventDelivery(uint8_t num, i2c_slave_event_mode_t mode, size_t depth);
+
+typedef struct {
+    uint32_t rx_isr_calls;      // RX FIFO reads done in the ISR
+    uint32_t rx_isr_bytes;      // bytes read from the RX FIFO in the ISR
+    uint64_t rx_isr_cycles;     // CPU cycles spent storing them into the RX buffer
+    uint32_t tx_bytes;          // bytes loaded into the TX FIFO
+    uint32_t rx_transactions;   // master writes ended by STOP or repeated START
+    uint32_t tx_transactions;   // master reads ended by STOP
+    uint32_t rx_overflows;      // bytes lost because the RX buffer was full
+    uint32_t event_overflows;   // events lost because the event queue was full
+    uint32_t worker_wakeups;    // worker task wake-ups, event count / wake-ups is the batching achieved
+    uint32_t pool_drops;        // transactions dropped because no pool buffer was free
+    uint32_t isr_calls;         // interrupt handler invocations, or polls that found work in polled mode
+    uint64_t isr_cycles;        // CPU cycles spent in the interrupt handler
+    uint32_t stretches;         // master read stretches released
+    uint32_t rx_full_stretches; // SCL held because the RX FIFO was full
+    uint32_t tx_empty_stretches;// SCL held because the TX FIFO ran empty during a read
+    uint32_t stretch_max_us;    // longest master read stretch
+    uint32_t stretch_hist[I2C_SLAVE_STRETCH_HIST_BINS]; // master read stretch to i2c_ll_stretch_clr, log2 us bins
+} i2c_slave_stats_t;
+// Copy of the counters, safe to call while the bus is running. Best effort: the ISR updates them without
+// a lock, so a copy taken during a transaction may mix values from before and after it, and on dual core
+// targets a 64-bit cycle counter may be torn. Compare deltas between idle bus moments for exact figures.
+esp_err_t i2cSlaveGetStats(uint8_t num, i2c_slave_stats_t * stats);
+esp_err_t i2cSlaveResetStats(uint8_t num);
+
+// transactions dropped because no pool buffer was free, same as i2c_slave_stats_t.pool_drops
+uint32_t i2cSlaveGetDropCount(uint8_t num);
+
 esp_err_t i2cSlaveInit(uint8_t num, int sda, int scl, uint16_t slaveID, uint32_t frequency, size_t rx_len, size_t tx_len);
+
+typedef struct {
+    int sda;
+    int scl;
+    uint16_t slave_addr;
+    uint32_t frequency;
+    size_t rx_len;
+    size_t tx_len;
+    uint32_t task_priority;     // worker task priority
+    uint32_t task_stack_size;   // worker task stack in bytes
+    int task_core;              // core the worker task is pinned to, -1 for any core
+    int intr_core;              // core the interrupt is allocated on, -1 for the calling core
+    bool intr_iram;             // IRAM-resident non-shared interrupt, keeps running while the flash cache is off, needs CONFIG_I2C_SLAVE_ISR_IN_IRAM
+    bool intr_shared;           // share the CPU interrupt line with other sources, false gives the port a line of its own
+    bool polled;                // no interrupt, the worker task busy-polls the peripheral and runs every callback inline, needs task_core 0 or 1
+    bool worker_disabled;       // no worker task, the application takes master writes with i2cSlaveRead or i2cSlaveReadAcquire
+    void * static_mem;          // 16 byte aligned internal RAM arena for every buffer, queue and the worker stack, NULL to use the heap
+    size_t static_mem_size;
+} i2c_slave_config_t;
+
+#define I2C_SLAVE_CONFIG_DEFAULT(sda_io, scl_io, addr) { \
+    .sda = (sda_io),                \
+    .scl = (scl_io),                \
+    .slave_addr = (addr),           \
+    .frequency = 100000,            \
+    .rx_len = 128,                  \
+    .tx_len = 128,                  \
+    .task_priority = 20,            \
+    .task_stack_size = 4096,        \
+    .task_core = -1,                \
+    .intr_core = -1,                \
+    .intr_iram = false,             \
+    .intr_shared = true,            \
+    .polled = false,                \
+    .worker_disabled = false,       \
+    .static_mem = NULL,             \
+    .static_mem_size = 0,           \
+}
+
+// static_mem bytes needed by i2cSlaveInitEx, event_depth as set by i2cSlaveSetEventDelivery (16 by default)
+#define I2C_SLAVE_STATIC_ALIGN(n) (((n) + 15) & ~(size_t)15)
+#define I2C_SLAVE_STATIC_MEM_SIZE(rx_len, tx_len, event_depth, task_stack_size) ( \
+    I2C_SLAVE_STATIC_ALIGN((rx_len) + 1) +                                        \
+    CONFIG_I2C_SLAVE_POOL_BUFFERS * I2C_SLAVE_STATIC_ALIGN(rx_len) +              \
+    I2C_SLAVE_STATIC_ALIGN((tx_len) + 1) +                                        \
+    I2C_SLAVE_STATIC_ALIGN((event_depth) * 8 + 1) +                               \
+    I2C_SLAVE_STATIC_ALIGN(task_stack_size))
+// add this when i2cSlaveSetResponseSlots is used
+#define I2C_SLAVE_STATIC_SLOTS_SIZE(count, max_len) \
+    (I2C_SLAVE_STATIC_ALIGN((count) * 8) + I2C_SLAVE_STATIC_ALIGN((count) * 2 * (max_len)))
+
+esp_err_t i2cSlaveInitEx(uint8_t num, const i2c_slave_config_t * config);
 esp_err_t i2cSlaveDeinit(uint8_t num);
 size_t i2cSlaveWrite(uint8_t num, const uint8_t *buf, uint32_t len, uint32_t timeout_ms);
 
+// Gather write: replaces the pending response like i2cSlaveWrite, with the fragments sent back to back.
+// They are copied straight into the TX FIFO and ring, the ISR sees the ring part with a single update.
+typedef struct {
+    const void * base;
+    size_t len;
+} i2c_slave_iovec_t;
+size_t i2cSlaveWritev(uint8_t num, const i2c_slave_iovec_t *iov, size_t iovcnt, uint32_t timeout_ms);
+
+// Build a response in place: Begin locks the port, Append copies fragments behind the ring head without
+// publishing them, Commit replaces the pending response with all of them at once, preloads the TX FIFO
+// and unlocks, Abort drops them and unlocks. Append, Commit and Abort fail unless the calling task is the
+// one that called Begin, and Begin fails if it already did. Between Begin and Commit/Abort the staging
+// task gets 0 / ESP_ERR_INVALID_STATE from i2cSlaveWrite, i2cSlaveWritev and i2cSlavePublishResponse,
+// and a request_callback writing from the worker blocks on the port lock, so a master read arriving
+// meanwhile stays stretched until Commit or Abort. Keep the staging window short.
+esp_err_t i2cSlaveWriteBegin(uint8_t num);
+size_t i2cSlaveWriteAppend(uint8_t num, const uint8_t *buf, size_t len);
+size_t i2cSlaveWriteCommit(uint8_t num);
+esp_err_t i2cSlaveWriteAbort(uint8_t num);
+// only from i2c_slave_isr_request_cb_t
+size_t i2cSlaveWriteFromISR(uint8_t num, const uint8_t *buf, uint32_t len);
+
+// Pull reads, for i2c_slave_config_t.worker_disabled: the calling task waits up to timeout_ms
+// (portMAX_DELAY for ever) for the next master write. Master reads, TX producer refills and register
+// map updates that come first are handled inline, request_callback and the other callbacks run in the
+// calling task. A master read stays stretched until the next call unless it is answered from the ISR
+// (i2cSlaveAttachIsrRequestCallback, i2cSlaveSetResponseSlots, register map mode), so keep one task
+// reading. With I2C_SLAVE_EVENT_NOTIFY the reading task's notification value is used.
+typedef struct {
+    const uint8_t * data;       // borrowed from the RX buffer (zero copy) or a pool buffer, valid until i2cSlaveReadRelease
+    size_t len;                 // without the PEC byte when info.pec is set
+    size_t offset;              // bytes of the same write returned before, chunked writes only
+    bool stop;                  // ended by STOP, false for a repeated START
+    bool end;                   // last part of the write, false only for i2cSlaveAttachRxChunkCallback chunks
+    i2c_slave_trans_info_t info;
+    void * priv_item;           // private to the driver
+    size_t priv_len;
+} i2c_slave_read_t;
+// ESP_ERR_TIMEOUT when nothing arrived, ESP_ERR_INVALID_STATE with the worker running or a span still held
+esp_err_t i2cSlaveReadAcquire(uint8_t num, i2c_slave_read_t * rd, uint32_t timeout_ms);
+esp_err_t i2cSlaveReadRelease(uint8_t num, i2c_slave_read_t * rd);
+// copies the next master write, bytes past len are dropped, 0 on timeout
+size_t i2cSlaveRead(uint8_t num, uint8_t * buf, size_t len, bool * stop, uint32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
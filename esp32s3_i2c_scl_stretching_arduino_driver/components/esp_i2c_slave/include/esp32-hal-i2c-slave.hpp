@@ -0,0 +1,162 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// C++17 header-only layer over esp32-hal-i2c-slave.h: the port and buffer sizes are template
+// parameters, every buffer lives in a static arena, and master requests are dispatched by the
+// command byte through a table built at compile time. No virtual calls, no heap.
+
+#if __cplusplus < 201703L
+#error "esp32-hal-i2c-slave.hpp needs C++17"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <initializer_list>
+
+#include "esp32-hal-i2c-slave.h"
+
+namespace esp_i2c_slave {
+
+// called from the worker task with the bytes the master wrote before the repeated START,
+// answers with I2cSlave<>::write
+using RequestHandler = void (*)(uint8_t num, const uint8_t *cmd, uint8_t cmd_len);
+using ReceiveHandler = void (*)(uint8_t num, const uint8_t *data, size_t len, bool stop);
+
+struct Command {
+    uint8_t cmd;
+    RequestHandler handler;
+};
+
+// 256 handlers indexed by the first command byte, plus the one for reads without a command
+struct CommandTable {
+    RequestHandler handlers[256];
+    RequestHandler no_cmd;
+
+    constexpr RequestHandler lookup(const uint8_t *cmd, uint8_t cmd_len) const
+    {
+        return cmd_len ? handlers[cmd[0]] : no_cmd;
+    }
+};
+
+namespace detail {
+// not constexpr: reaching it while building a table is a compile error
+inline void duplicate_command() {}
+}
+
+// fallback handles unlisted commands and reads without a command, nullptr leaves them unanswered
+template <typename... Commands>
+constexpr CommandTable makeCommandTable(RequestHandler fallback, Commands... commands)
+{
+    CommandTable table{};
+    for(auto &handler : table.handlers){
+        handler = fallback;
+    }
+    table.no_cmd = fallback;
+    bool used[256] = {};
+    //the leading empty entry keeps the list valid without commands
+    for(const Command &c : {Command{0, nullptr}, commands...}){
+        if(!c.handler){
+            continue;
+        }
+        if(used[c.cmd]){
+            detail::duplicate_command();
+        }
+        used[c.cmd] = true;
+        table.handlers[c.cmd] = c.handler;
+    }
+    return table;
+}
+
+// One port, all static: I2cSlave<0, 256, 256, kTable>::begin(sda, scl, addr).
+// EventDepth must match i2cSlaveSetEventDelivery, use setEventDelivery to keep them in sync.
+template <uint8_t Port, size_t RxLen, size_t TxLen, const CommandTable &Table,
+          size_t StackSize = 4096, size_t EventDepth = 16>
+class I2cSlave {
+    static_assert(Port < SOC_I2C_NUM, "invalid I2C port");
+    static_assert(RxLen > 0 && TxLen > 0, "RX and TX buffers can not be empty");
+    static_assert(EventDepth > 0, "the event queue can not be empty");
+
+public:
+    static constexpr uint8_t port = Port;
+    static constexpr size_t static_mem_size = I2C_SLAVE_STATIC_MEM_SIZE(RxLen, TxLen, EventDepth, StackSize);
+
+    I2cSlave() = delete;
+
+    static esp_err_t setEventDelivery(i2c_slave_event_mode_t mode)
+    {
+        return i2cSlaveSetEventDelivery(Port, mode, EventDepth);
+    }
+
+    // config may carry the task and interrupt placement, sizes and memory are taken from the template
+    static esp_err_t begin(const i2c_slave_config_t &config, ReceiveHandler on_receive = nullptr)
+    {
+        i2c_slave_config_t cfg = config;
+        cfg.rx_len = RxLen;
+        cfg.tx_len = TxLen;
+        cfg.task_stack_size = StackSize;
+        cfg.static_mem = mem_;
+        cfg.static_mem_size = sizeof(mem_);
+        receive_handler_ = on_receive;
+        esp_err_t err = i2cSlaveAttachCallbacks(Port, onRequest, onReceive, nullptr);
+        if(err != ESP_OK){
+            return err;
+        }
+        return i2cSlaveInitEx(Port, &cfg);
+    }
+
+    static esp_err_t begin(int sda, int scl, uint16_t slave_addr, uint32_t frequency = 100000, ReceiveHandler on_receive = nullptr)
+    {
+        i2c_slave_config_t cfg = I2C_SLAVE_CONFIG_DEFAULT(sda, scl, slave_addr);
+        cfg.frequency = frequency;
+        return begin(cfg, on_receive);
+    }
+
+    static esp_err_t end()
+    {
+        return i2cSlaveDeinit(Port);
+    }
+
+    static size_t write(const uint8_t *buf, uint32_t len, uint32_t timeout_ms = 0)
+    {
+        return i2cSlaveWrite(Port, buf, len, timeout_ms);
+    }
+
+    static esp_err_t getStats(i2c_slave_stats_t &stats)
+    {
+        return i2cSlaveGetStats(Port, &stats);
+    }
+
+private:
+    static void onRequest(uint8_t num, uint8_t *cmd, uint8_t cmd_len, void *arg)
+    {
+        RequestHandler handler = Table.lookup(cmd, cmd_len);
+        if(handler){
+            handler(num, cmd, cmd_len);
+        }
+    }
+
+    static void onReceive(uint8_t num, uint8_t *data, size_t len, bool stop, void *arg)
+    {
+        if(receive_handler_){
+            receive_handler_(num, data, len, stop);
+        }
+    }
+
+    alignas(16) static inline uint8_t mem_[static_mem_size];
+    static inline ReceiveHandler receive_handler_ = nullptr;
+};
+
+} // namespace esp_i2c_slave
@@ -0,0 +1,39 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stdint.h"
+#include "stddef.h"
+
+// SMBus Packet Error Code, CRC-8 with polynomial x^8 + x^2 + x + 1 (0x07), initial value 0,
+// over every byte of the transaction including the address bytes (addr << 1 | rw).
+// Plain C without any IDF dependency, so it also builds on the host.
+
+#define SMBUS_PEC_INIT 0x00
+
+// table driven, one lookup per byte
+uint8_t smbus_pec_update(uint8_t pec, const uint8_t * data, size_t len);
+// bit by bit reference implementation, to check smbus_pec_update against
+uint8_t smbus_pec_update_ref(uint8_t pec, const uint8_t * data, size_t len);
+// single byte step, e.g. for the address byte
+uint8_t smbus_pec_byte(uint8_t pec, uint8_t byte);
+
+#ifdef __cplusplus
+}
+#endif
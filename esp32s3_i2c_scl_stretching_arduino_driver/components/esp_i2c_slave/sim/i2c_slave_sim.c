@@ -0,0 +1,221 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "i2c_slave_hal.h"
+
+// the model follows the S3: SCL is stretched at the address of a master read, on an empty TX FIFO
+// and on a full RX FIFO, each with I2C_SLAVE_STRETCH_INT and the cause in the status register
+
+#define I2C_SLAVE_SIM_ISR_LOOPS 16
+
+i2c_dev_t I2C0 = { .lock = portMUX_INITIALIZER_UNLOCKED };
+#if SOC_I2C_NUM > 1
+i2c_dev_t I2C1 = { .lock = portMUX_INITIALIZER_UNLOCKED };
+#endif
+
+static i2c_dev_t * const sim_devs[SOC_I2C_NUM] = {
+    &I2C0,
+#if SOC_I2C_NUM > 1
+    &I2C1,
+#endif
+};
+
+int64_t i2c_slave_sim_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+esp_err_t esp_intr_alloc(int source, int flags, intr_handler_t handler, void *arg, intr_handle_t *ret_handle)
+{
+    if(source < 0 || source >= SOC_I2C_NUM || !handler){
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_dev_t * hw = sim_devs[source];
+    if(hw->isr){
+        return ESP_ERR_NOT_FOUND;
+    }
+    portENTER_CRITICAL(&hw->lock);
+    hw->isr_arg = arg;
+    hw->isr = handler;
+    portEXIT_CRITICAL(&hw->lock);
+    if(ret_handle){
+        *ret_handle = hw;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_intr_free(intr_handle_t handle)
+{
+    if(!handle){
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&handle->lock);
+    handle->isr = NULL;
+    handle->isr_arg = NULL;
+    portEXIT_CRITICAL(&handle->lock);
+    return ESP_OK;
+}
+
+void i2c_slave_sim_raise(i2c_dev_t *hw)
+{
+    for(int i = 0; i < I2C_SLAVE_SIM_ISR_LOOPS; i++){
+        portENTER_CRITICAL(&hw->lock);
+        bool run = hw->isr && !hw->in_isr && i2c_slave_sim_pending(hw);
+        hw->in_isr |= run;
+        portEXIT_CRITICAL(&hw->lock);
+        if(!run){
+            return;
+        }
+        hw->isr(hw->isr_arg);
+        hw->in_isr = false;
+    }
+}
+
+//-------------------------------------- Master model -----------------------------------------------------------------
+
+// hold SCL low until the driver clears the stretch, the worker task runs while this task blocks
+// on stretch_sem, so the measured time is the driver's, not the tick period
+static void sim_stretch(i2c_dev_t *hw, i2c_stretch_cause_t cause)
+{
+    if(hw->stretch_sem){
+        //drop a give left over from a stretch that timed out
+        xSemaphoreTake(hw->stretch_sem, 0);
+    }
+    int64_t start = i2c_slave_sim_time_us();
+    portENTER_CRITICAL(&hw->lock);
+    hw->cause = cause;
+    hw->stretched = true;
+    hw->int_raw |= I2C_SLAVE_STRETCH_INT_ENA;
+    portEXIT_CRITICAL(&hw->lock);
+    i2c_slave_sim_raise(hw);
+    while(hw->stretched){
+        int64_t left = I2C_SLAVE_SIM_STRETCH_TIMEOUT_US - (i2c_slave_sim_time_us() - start);
+        if(left <= 0){
+            hw->stretched = false;
+            hw->stats.stretch_timeouts++;
+            break;
+        }
+        if(hw->stretch_sem){
+            xSemaphoreTake(hw->stretch_sem, pdMS_TO_TICKS(left / 1000) + 1);
+        } else {
+            vTaskDelay(1);
+        }
+    }
+    uint32_t held = (uint32_t)(i2c_slave_sim_time_us() - start);
+    hw->stats.stretches++;
+    hw->stats.stretch_total_us += held;
+    if(held > hw->stats.stretch_max_us){
+        hw->stats.stretch_max_us = held;
+    }
+}
+
+static void sim_write_byte(i2c_dev_t *hw, uint8_t byte)
+{
+    if(hw->rx_cnt == SOC_I2C_FIFO_LEN && hw->stretch_en){
+        sim_stretch(hw, I2C_STRETCH_CAUSE_RX_FIFO_FULL);
+    }
+    portENTER_CRITICAL(&hw->lock);
+    bool full = (hw->rx_cnt == SOC_I2C_FIFO_LEN);
+    if(!full){
+        hw->rx_fifo[(hw->rx_rd + hw->rx_cnt) % SOC_I2C_FIFO_LEN] = byte;
+        hw->rx_cnt++;
+    }
+    portEXIT_CRITICAL(&hw->lock);
+    if(full){
+        hw->stats.rx_overruns++;
+    }
+    i2c_slave_sim_raise(hw);
+}
+
+static uint8_t sim_read_byte(i2c_dev_t *hw)
+{
+    if(!hw->tx_cnt && hw->stretch_en){
+        sim_stretch(hw, I2C_STRETCH_CAUSE_TX_FIFO_EMPTY);
+    }
+    uint8_t byte = 0xFF;
+    portENTER_CRITICAL(&hw->lock);
+    bool empty = !hw->tx_cnt;
+    if(!empty){
+        byte = hw->tx_fifo[hw->tx_rd];
+        hw->tx_rd = (hw->tx_rd + 1) % SOC_I2C_FIFO_LEN;
+        hw->tx_cnt--;
+    }
+    portEXIT_CRITICAL(&hw->lock);
+    if(empty){
+        hw->stats.tx_underruns++;
+    }
+    i2c_slave_sim_raise(hw);
+    return byte;
+}
+
+esp_err_t i2c_slave_sim_master_transfer(uint8_t num, uint16_t addr, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len)
+{
+    if(num >= SOC_I2C_NUM || (wr_len && !wr) || (rd_len && !rd)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_dev_t * hw = sim_devs[num];
+    if(addr != hw->addr || !hw->int_ena){
+        hw->stats.nacks++;
+        return ESP_ERR_NOT_FOUND;
+    }
+    hw->addressed = true;
+    if(wr_len || !rd_len){
+        hw->rw = false;
+        for(size_t i = 0; i < wr_len; i++){
+            sim_write_byte(hw, wr[i]);
+        }
+    }
+    if(rd_len){
+        //repeated START, address + R
+        hw->rw = true;
+        if(hw->stretch_en){
+            sim_stretch(hw, I2C_STRETCH_CAUSE_MASTER_READ);
+        }
+        for(size_t i = 0; i < rd_len; i++){
+            rd[i] = sim_read_byte(hw);
+        }
+    }
+    //STOP
+    portENTER_CRITICAL(&hw->lock);
+    hw->int_raw |= I2C_TRANS_COMPLETE_INT_ENA;
+    portEXIT_CRITICAL(&hw->lock);
+    i2c_slave_sim_raise(hw);
+    hw->addressed = false;
+    hw->stats.transactions++;
+    return ESP_OK;
+}
+
+void i2c_slave_sim_get_stats(uint8_t num, i2c_slave_sim_stats_t *stats)
+{
+    if(num < SOC_I2C_NUM && stats){
+        *stats = sim_devs[num]->stats;
+    }
+}
+
+void i2c_slave_sim_reset_stats(uint8_t num)
+{
+    if(num < SOC_I2C_NUM){
+        memset(&sim_devs[num]->stats, 0, sizeof(i2c_slave_sim_stats_t));
+    }
+}
@@ -0,0 +1,326 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Linux side of i2c_slave_hal.h: the names the driver uses, backed by the simulated peripheral.
+// Only included from i2c_slave_hal.h, after i2c_stretch_cause_t.
+
+#include <string.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "i2c_slave_sim.h"
+
+#define I2C_SLAVE_HAL_MULTICORE 0
+
+// the simulated ISR runs in task context
+#ifndef portENTER_CRITICAL_SAFE
+#define portENTER_CRITICAL_SAFE(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_SAFE(mux) portEXIT_CRITICAL(mux)
+#endif
+
+#define i2c_slave_cycles() ((uint32_t)i2c_slave_sim_time_us())
+#define i2c_slave_cycles_per_us() 1
+#define i2c_slave_core_id() 0
+
+static inline int64_t esp_timer_get_time(void)
+{
+    return i2c_slave_sim_time_us();
+}
+
+//-------------------------------------- Interrupts -------------------------------------------------------------------
+// same bits as soc/i2c_reg.h of the S3
+#define I2C_RXFIFO_WM_INT_ENA       (1UL << 0)
+#define I2C_TXFIFO_WM_INT_ENA       (1UL << 1)
+#define I2C_TRANS_COMPLETE_INT_ENA  (1UL << 7)
+#define I2C_SLAVE_STRETCH_INT_ENA   (1UL << 16)
+#define I2C_LL_INTR_MASK            0x3ffffUL
+#define I2C_LL_MAX_TIMEOUT          0x1f
+
+#define ESP_INTR_FLAG_LOWMED        (1 << 1)
+#define ESP_INTR_FLAG_SHARED        (1 << 8)
+#define ESP_INTR_FLAG_IRAM          (1 << 10)
+
+typedef void (*intr_handler_t)(void *arg);
+typedef struct i2c_dev_t * intr_handle_t;
+
+//-------------------------------------- Peripheral -------------------------------------------------------------------
+// Registers are plain fields guarded by lock: the master task and the worker task both touch them,
+// the ISR runs in whichever of the two raised the interrupt.
+typedef struct i2c_dev_t {
+    portMUX_TYPE lock;
+    uint8_t rx_fifo[SOC_I2C_FIFO_LEN];
+    uint8_t tx_fifo[SOC_I2C_FIFO_LEN];
+    uint32_t rx_rd, rx_cnt;
+    uint32_t tx_rd, tx_cnt;
+    uint32_t rx_thr, tx_thr;
+    uint32_t int_raw;           // edge causes, the FIFO watermarks are computed from the counts
+    uint32_t int_ena;
+    uint16_t addr;
+    bool stretch_en;
+    volatile bool stretched;
+    SemaphoreHandle_t stretch_sem;  // given by i2c_ll_stretch_clr, the stretching master task waits on it
+    i2c_stretch_cause_t cause;
+    bool rw;
+    bool addressed;
+    bool in_isr;
+    intr_handler_t isr;
+    void * isr_arg;
+    i2c_slave_sim_stats_t stats;
+} i2c_dev_t;
+
+extern i2c_dev_t I2C0;
+#if SOC_I2C_NUM > 1
+extern i2c_dev_t I2C1;
+#endif
+
+// call the ISR while an enabled interrupt is pending, like a level triggered line
+void i2c_slave_sim_raise(i2c_dev_t *hw);
+
+static inline uint32_t i2c_slave_sim_pending(const i2c_dev_t *hw)
+{
+    uint32_t st = hw->int_raw;
+    if(hw->rx_cnt && hw->rx_cnt >= hw->rx_thr){
+        st |= I2C_RXFIFO_WM_INT_ENA;
+    }
+    if(hw->tx_cnt <= hw->tx_thr){
+        st |= I2C_TXFIFO_WM_INT_ENA;
+    }
+    return st & hw->int_ena;
+}
+
+static inline void i2c_ll_get_intr_mask(i2c_dev_t *hw, uint32_t *intr_status)
+{
+    portENTER_CRITICAL_ISR(&hw->lock);
+    *intr_status = i2c_slave_sim_pending(hw);
+    portEXIT_CRITICAL_ISR(&hw->lock);
+}
+
+static inline void i2c_ll_clr_intsts_mask(i2c_dev_t *hw, uint32_t mask)
+{
+    portENTER_CRITICAL_ISR(&hw->lock);
+    hw->int_raw &= ~mask;
+    portEXIT_CRITICAL_ISR(&hw->lock);
+}
+
+static inline void i2c_ll_disable_intr_mask(i2c_dev_t *hw, uint32_t mask)
+{
+    portENTER_CRITICAL_ISR(&hw->lock);
+    hw->int_ena &= ~mask;
+    portEXIT_CRITICAL_ISR(&hw->lock);
+}
+
+static inline void i2c_slave_sim_enable_intr_mask(i2c_dev_t *hw, uint32_t mask)
+{
+    portENTER_CRITICAL_ISR(&hw->lock);
+    hw->int_ena |= mask;
+    portEXIT_CRITICAL_ISR(&hw->lock);
+    i2c_slave_sim_raise(hw);
+}
+
+static inline void i2c_ll_slave_enable_rx_it(i2c_dev_t *hw)
+{
+    i2c_slave_sim_enable_intr_mask(hw, I2C_RXFIFO_WM_INT_ENA | I2C_TRANS_COMPLETE_INT_ENA);
+}
+
+static inline void i2c_ll_slave_enable_tx_it(i2c_dev_t *hw)
+{
+    i2c_slave_sim_enable_intr_mask(hw, I2C_TXFIFO_WM_INT_ENA);
+}
+
+static inline void i2c_ll_slave_disable_tx_it(i2c_dev_t *hw)
+{
+    i2c_ll_disable_intr_mask(hw, I2C_TXFIFO_WM_INT_ENA);
+}
+
+//-------------------------------------- FIFOs ------------------------------------------------------------------------
+static inline void i2c_ll_get_rxfifo_cnt(i2c_dev_t *hw, uint32_t *length)
+{
+    *length = hw->rx_cnt;
+}
+
+static inline void i2c_ll_get_txfifo_len(i2c_dev_t *hw, uint32_t *length)
+{
+    *length = SOC_I2C_FIFO_LEN - hw->tx_cnt;
+}
+
+static inline void i2c_ll_read_rxfifo(i2c_dev_t *hw, uint8_t *buf, uint32_t len)
+{
+    portENTER_CRITICAL_ISR(&hw->lock);
+    for(uint32_t i = 0; i < len && hw->rx_cnt; i++){
+        buf[i] = hw->rx_fifo[hw->rx_rd];
+        hw->rx_rd = (hw->rx_rd + 1) % SOC_I2C_FIFO_LEN;
+        hw->rx_cnt--;
+    }
+    portEXIT_CRITICAL_ISR(&hw->lock);
+}
+
+static inline void i2c_ll_write_txfifo(i2c_dev_t *hw, const uint8_t *buf, uint32_t len)
+{
+    portENTER_CRITICAL_ISR(&hw->lock);
+    for(uint32_t i = 0; i < len && hw->tx_cnt < SOC_I2C_FIFO_LEN; i++){
+        hw->tx_fifo[(hw->tx_rd + hw->tx_cnt) % SOC_I2C_FIFO_LEN] = buf[i];
+        hw->tx_cnt++;
+    }
+    portEXIT_CRITICAL_ISR(&hw->lock);
+}
+
+static inline void i2c_ll_rxfifo_rst(i2c_dev_t *hw)
+{
+    portENTER_CRITICAL_ISR(&hw->lock);
+    hw->rx_rd = hw->rx_cnt = 0;
+    portEXIT_CRITICAL_ISR(&hw->lock);
+}
+
+static inline void i2c_ll_txfifo_rst(i2c_dev_t *hw)
+{
+    portENTER_CRITICAL_ISR(&hw->lock);
+    hw->tx_rd = hw->tx_cnt = 0;
+    portEXIT_CRITICAL_ISR(&hw->lock);
+}
+
+static inline void i2c_ll_set_rxfifo_full_thr(i2c_dev_t *hw, uint8_t full_thr)
+{
+    hw->rx_thr = full_thr;
+}
+
+static inline void i2c_ll_set_txfifo_empty_thr(i2c_dev_t *hw, uint8_t empty_thr)
+{
+    hw->tx_thr = empty_thr;
+}
+
+//-------------------------------------- Slave state ------------------------------------------------------------------
+static inline void i2c_ll_stretch_clr(i2c_dev_t *hw)
+{
+    bool wake = hw->stretched;
+    hw->stretched = false;
+    if(wake && hw->stretch_sem){
+        xSemaphoreGive(hw->stretch_sem);
+    }
+}
+
+static inline void i2c_ll_set_stretch(i2c_dev_t *hw, uint16_t time)
+{
+    hw->stretch_en = (time > 0);
+    if(time > 0){
+        i2c_slave_sim_enable_intr_mask(hw, I2C_SLAVE_STRETCH_INT_ENA);
+    } else {
+        i2c_ll_disable_intr_mask(hw, I2C_SLAVE_STRETCH_INT_ENA);
+    }
+}
+
+static inline i2c_stretch_cause_t i2c_ll_stretch_cause(i2c_dev_t *hw)
+{
+    return hw->cause;
+}
+
+static inline bool i2c_ll_slave_addressed(i2c_dev_t *hw)
+{
+    return hw->addressed;
+}
+
+static inline bool i2c_ll_slave_rw(i2c_dev_t *hw)
+{
+    return hw->rw;
+}
+
+static inline void i2c_ll_slave_init(i2c_dev_t *hw)
+{
+    portENTER_CRITICAL(&hw->lock);
+    hw->rx_rd = hw->rx_cnt = hw->tx_rd = hw->tx_cnt = 0;
+    hw->int_raw = hw->int_ena = 0;
+    hw->stretch_en = hw->stretched = false;
+    hw->rw = hw->addressed = false;
+    portEXIT_CRITICAL(&hw->lock);
+    if(!hw->stretch_sem){
+        hw->stretch_sem = xSemaphoreCreateBinary();
+    }
+}
+
+static inline void i2c_ll_set_slave_addr(i2c_dev_t *hw, uint16_t slave_addr, bool addr_10bit_en)
+{
+    hw->addr = slave_addr;
+}
+
+static inline bool i2c_ll_is_bus_busy(i2c_dev_t *hw)
+{
+    return false;
+}
+
+// bus timing, glitch filter and FIFO mode do not change the model
+static inline void i2c_ll_set_tout(i2c_dev_t *hw, int tout) {}
+static inline void i2c_ll_set_filter(i2c_dev_t *hw, uint8_t filter_num) {}
+static inline void i2c_ll_set_fifo_mode(i2c_dev_t *hw, bool fifo_mode_en) {}
+static inline void i2c_ll_update(i2c_dev_t *hw) {}
+static inline void i2c_slave_hal_set_bus_clk(i2c_dev_t *hw, uint32_t clk_speed) {}
+static inline void i2c_slave_hal_enable_periph(uint8_t num) {}
+
+// no task watchdog on the host
+static inline bool i2c_slave_hal_idle_wdt_remove(int core)
+{
+    return false;
+}
+
+static inline void i2c_slave_hal_idle_wdt_restore(int core) {}
+
+static inline int i2c_slave_hal_intr_source(uint8_t num)
+{
+    return num;
+}
+
+esp_err_t esp_intr_alloc(int source, int flags, intr_handler_t handler, void *arg, intr_handle_t *ret_handle);
+esp_err_t esp_intr_free(intr_handle_t handle);
+
+//-------------------------------------- GPIO -------------------------------------------------------------------------
+// the simulated bus is always idle when the driver checks it
+typedef enum {
+    GPIO_MODE_INPUT = 1,
+    GPIO_MODE_OUTPUT = 2,
+    GPIO_MODE_DEF_OD = 4,
+    GPIO_MODE_INPUT_OUTPUT_OD = 7,
+} gpio_mode_t;
+
+#define GPIO_PULLUP_ENABLE      1
+#define GPIO_PULLDOWN_DISABLE   0
+#define GPIO_INTR_DISABLE       0
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    int pull_up_en;
+    int pull_down_en;
+    int intr_type;
+} gpio_config_t;
+
+#define I2C_SCL_IDX(p) (p)
+#define I2C_SDA_IDX(p) (p)
+
+static inline esp_err_t gpio_config(const gpio_config_t *conf)
+{
+    return ESP_OK;
+}
+
+static inline esp_err_t gpio_set_level(int gpio_num, uint32_t level)
+{
+    return ESP_OK;
+}
+
+static inline int gpio_get_level(int gpio_num)
+{
+    return 1;
+}
+
+static inline void gpio_matrix_out(uint32_t gpio, uint32_t signal_idx, bool out_inv, bool oen_inv) {}
+static inline void gpio_matrix_in(uint32_t gpio, uint32_t signal_idx, bool inv) {}
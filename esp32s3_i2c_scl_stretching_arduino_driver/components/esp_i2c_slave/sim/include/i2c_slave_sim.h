@@ -0,0 +1,65 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Simulated I2C slave peripheral and scripted master, linux target only.
+// The driver runs unchanged on top of it, see i2c_slave_sim_hal.h.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "esp_err.h"
+
+// the S3 peripheral
+#ifndef SOC_I2C_NUM
+#define SOC_I2C_NUM 2
+#endif
+#ifndef SOC_I2C_FIFO_LEN
+#define SOC_I2C_FIFO_LEN 32
+#endif
+
+// a stretch the driver does not release within this time is released by the simulated peripheral
+#define I2C_SLAVE_SIM_STRETCH_TIMEOUT_US 100000
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t nacks;             // address did not match or the slave is not initialized
+    uint32_t stretches;
+    uint32_t stretch_timeouts;
+    uint64_t stretch_total_us;  // SCL held low by the slave, summed over all stretches
+    uint32_t stretch_max_us;
+    uint32_t rx_overruns;       // bytes the master wrote into a full RX FIFO
+    uint32_t tx_underruns;      // bytes the master read from an empty TX FIFO, read as 0xFF
+} i2c_slave_sim_stats_t;
+
+// Runs one transaction from the calling task: START, address + W and wr_len bytes, then if rd_len is
+// set a repeated START, address + R and rd_len bytes, then STOP. Interrupts are delivered by calling
+// the driver ISR from this task, so it should run below the worker task priority.
+// Returns ESP_ERR_NOT_FOUND when the address is not acknowledged.
+esp_err_t i2c_slave_sim_master_transfer(uint8_t num, uint16_t addr, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len);
+
+void i2c_slave_sim_get_stats(uint8_t num, i2c_slave_sim_stats_t *stats);
+void i2c_slave_sim_reset_stats(uint8_t num);
+
+// monotonic host time, the simulated esp_timer_get_time
+int64_t i2c_slave_sim_time_us(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,248 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "i2c_master_async.h"
+
+static const char *TAG = "i2c_async";
+
+typedef struct {
+    QueueHandle_t queue;        // i2c_async_trans_t pointers, in submission order
+    TaskHandle_t task;
+    i2c_port_t port;
+    TickType_t timeout_ticks;
+    i2c_async_stats_t stats;
+} i2c_async_bus_t;
+
+static i2c_async_bus_t s_bus[I2C_NUM_MAX];
+// stats are updated by submitters and the bus tasks, possibly on both cores
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void i2c_async_task(void *pv_args);
+
+esp_err_t i2c_async_init(const i2c_async_config_t * config)
+{
+    if (config == NULL || config->port < 0 || config->port >= I2C_NUM_MAX || config->queue_depth == 0) {
+        ESP_LOGE(TAG, "Invalid config");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->task_core < -1 || config->task_core >= portNUM_PROCESSORS) {
+        ESP_LOGE(TAG, "invalid core %d", config->task_core);
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_async_bus_t * bus = &s_bus[config->port];
+    if (bus->task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset(&bus->stats, 0, sizeof(bus->stats));
+    bus->port = config->port;
+    bus->timeout_ticks = pdMS_TO_TICKS(config->timeout_ms);
+    bus->queue = xQueueCreate(config->queue_depth, sizeof(i2c_async_trans_t *));
+    if (bus->queue == NULL) {
+        ESP_LOGE(TAG, "Transaction queue create failed");
+        return ESP_ERR_NO_MEM;
+    }
+    BaseType_t task_core = (config->task_core < 0) ? tskNO_AFFINITY : config->task_core;
+    xTaskCreatePinnedToCore(i2c_async_task, TAG, config->task_stack_size, bus, config->task_priority, &bus->task, task_core);
+    if (bus->task == NULL) {
+        ESP_LOGE(TAG, "Bus task create failed");
+        vQueueDelete(bus->queue);
+        bus->queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_async_deinit(i2c_port_t port)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || s_bus[port].task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c_async_bus_t * bus = &s_bus[port];
+    esp_err_t ret = i2c_async_flush(port, portMAX_DELAY);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    //the bus task is idle, blocked on the empty queue
+    vTaskDelete(bus->task);
+    bus->task = NULL;
+    vQueueDelete(bus->queue);
+    bus->queue = NULL;
+    return ESP_OK;
+}
+
+esp_err_t i2c_async_submit(i2c_port_t port, i2c_async_trans_t * trans, TickType_t wait_ticks)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || trans == NULL
+        || (trans->write_len && trans->write_buf == NULL) || (trans->read_len && trans->read_buf == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_async_bus_t * bus = &s_bus[port];
+    if (bus->queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    trans->result = ESP_ERR_NOT_FINISHED;
+    trans->link = NULL;
+    if (trans->write_len || trans->read_len) {
+        //encode here, the bus task goes straight from one i2c_master_cmd_begin to the next
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(trans->link_buf, sizeof(trans->link_buf));
+        if (cmd == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        i2c_master_start(cmd);
+        if (trans->write_len) {
+            i2c_master_write_byte(cmd, (trans->addr << 1) | I2C_MASTER_WRITE, true);
+            i2c_master_write(cmd, trans->write_buf, trans->write_len, true);
+            if (trans->read_len) {
+                i2c_master_start(cmd);
+            }
+        }
+        if (trans->read_len) {
+            i2c_master_write_byte(cmd, (trans->addr << 1) | I2C_MASTER_READ, true);
+            i2c_master_read(cmd, trans->read_buf, trans->read_len, I2C_MASTER_LAST_NACK);
+        }
+        i2c_master_stop(cmd);
+        trans->link = cmd;
+    }
+    //count it first, the bus task may finish it before xQueueSend returns
+    portENTER_CRITICAL(&s_stats_lock);
+    bus->stats.submitted++;
+    portEXIT_CRITICAL(&s_stats_lock);
+    if (xQueueSend(bus->queue, &trans, wait_ticks) != pdTRUE) {
+        portENTER_CRITICAL(&s_stats_lock);
+        bus->stats.submitted--;
+        bus->stats.queue_full++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        if (trans->link) {
+            i2c_cmd_link_delete_static(trans->link);
+            trans->link = NULL;
+        }
+        return ESP_ERR_TIMEOUT;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    uint32_t pending = bus->stats.submitted - bus->stats.completed;
+    if (pending > bus->stats.max_pending) {
+        bus->stats.max_pending = pending;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
+
+static void i2c_async_fence_done(i2c_async_trans_t * trans, void * arg)
+{
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+}
+
+esp_err_t i2c_async_flush(i2c_port_t port, TickType_t wait_ticks)
+{
+    //an empty transaction behind everything submitted so far, the queue is FIFO
+    StaticSemaphore_t done_static;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&done_static);
+    i2c_async_trans_t fence = {
+        .done_cb = i2c_async_fence_done,
+        .arg = done,
+    };
+    esp_err_t ret = i2c_async_submit(port, &fence, wait_ticks);
+    if (ret == ESP_OK) {
+        //the fence lives on this stack, wait for it even past wait_ticks
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(done);
+    return ret;
+}
+
+esp_err_t i2c_async_get_stats(i2c_port_t port, i2c_async_stats_t * stats)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_bus[port].stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
+
+esp_err_t i2c_async_reset_stats(i2c_port_t port)
+{
+    if (port < 0 || port >= I2C_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_async_stats_t * stats = &s_bus[port].stats;
+    //keep the pending count consistent for max_pending
+    portENTER_CRITICAL(&s_stats_lock);
+    stats->submitted -= stats->completed;
+    stats->completed = 0;
+    stats->failed = 0;
+    stats->queue_full = 0;
+    stats->max_pending = 0;
+    stats->busy_us = 0;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
+
+static void i2c_async_task(void *pv_args)
+{
+    i2c_async_bus_t * bus = (i2c_async_bus_t *)pv_args;
+    i2c_async_trans_t * trans = NULL;
+    i2c_async_trans_t done;
+    for (;;) {
+        if (xQueueReceive(bus->queue, &trans, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        //the owner may reuse trans as soon as result is set, take what is needed afterwards first
+        i2c_async_done_cb_t done_cb = trans->done_cb;
+        void * arg = trans->arg;
+        TaskHandle_t notify_task = trans->notify_task;
+        esp_err_t result = ESP_OK;
+        int64_t start_us = esp_timer_get_time();
+        if (trans->link) {
+            result = i2c_master_cmd_begin(bus->port, trans->link, bus->timeout_ticks);
+            i2c_cmd_link_delete_static(trans->link);
+            trans->link = NULL;
+        }
+        int64_t end_us = esp_timer_get_time();
+        portENTER_CRITICAL(&s_stats_lock);
+        bus->stats.busy_us += end_us - start_us;
+        if (result != ESP_OK) {
+            bus->stats.failed++;
+        }
+        bus->stats.completed++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        trans->start_us = start_us;
+        trans->end_us = end_us;
+        if (done_cb) {
+            //done_cb gets a copy of the public fields, trans is no longer ours once result is set
+            memcpy(&done, trans, offsetof(i2c_async_trans_t, link));
+            done.result = result;
+            done.link = NULL;
+        }
+        __atomic_store_n(&trans->result, result, __ATOMIC_RELEASE);
+        if (done_cb) {
+            done_cb(&done, arg);
+        }
+        if (notify_task) {
+            xTaskNotifyGive(notify_task);
+        }
+    }
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,108 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2c.h"
+
+// Asynchronous front-end for the legacy I2C master driver: callers queue transactions and return
+// immediately, a bus task per port runs them back to back with i2c_master_cmd_begin. The command
+// link of a transaction is encoded by i2c_async_submit in the caller's context, so the bus task
+// only starts the next transfer between two transactions.
+
+#ifndef ESP_ERR_NOT_FINISHED
+#define ESP_ERR_NOT_FINISHED 0x10C  // esp_err.h of IDF 5.0
+#endif
+
+// one link covers START, address + W, write, repeated START, address + R, read ACK, read NACK, STOP
+#define I2C_ASYNC_LINK_SIZE I2C_LINK_RECOMMENDED_SIZE(2)
+
+typedef struct i2c_async_trans_t i2c_async_trans_t;
+// called from the bus task, keep it short: the next transaction waits for it. trans is a copy of the
+// finished transaction, the original may already be reused by its owner. read_buf is not touched by
+// the bus until the callback returns.
+typedef void (*i2c_async_done_cb_t) (i2c_async_trans_t * trans, void * arg);
+
+struct i2c_async_trans_t {
+    uint16_t addr;              // 7 bit slave address
+    const uint8_t * write_buf;  // written first, may be NULL with write_len 0
+    size_t write_len;
+    uint8_t * read_buf;         // read after a repeated START (or right after START without a write)
+    size_t read_len;
+    i2c_async_done_cb_t done_cb;// optional completion callback
+    void * arg;
+    TaskHandle_t notify_task;   // optional, gets xTaskNotifyGive once the transaction is done
+    esp_err_t result;           // ESP_ERR_NOT_FINISHED while queued, the i2c_master_cmd_begin result afterwards
+    int64_t start_us;           // esp_timer time the bus task started the transfer
+    int64_t end_us;             // and the time it returned
+    // private to the component, the transaction must stay valid and untouched until it is done
+    i2c_cmd_handle_t link;
+    uint8_t link_buf[I2C_ASYNC_LINK_SIZE];
+};
+
+typedef struct {
+    i2c_port_t port;            // master port, installed with i2c_driver_install beforehand
+    size_t queue_depth;         // transactions that may be outstanding
+    uint32_t timeout_ms;        // per transaction i2c_master_cmd_begin timeout, includes slave clock stretching
+    uint32_t task_priority;     // bus task priority
+    uint32_t task_stack_size;   // bus task stack in bytes
+    int task_core;              // core the bus task is pinned to, -1 for any core
+} i2c_async_config_t;
+
+#define I2C_ASYNC_CONFIG_DEFAULT(port_num) { \
+    .port = (port_num),             \
+    .queue_depth = 8,               \
+    .timeout_ms = 1000,             \
+    .task_priority = 10,            \
+    .task_stack_size = 3072,        \
+    .task_core = -1,                \
+}
+
+typedef struct {
+    uint32_t submitted;         // transactions accepted by i2c_async_submit
+    uint32_t completed;         // transactions done, failed ones included
+    uint32_t failed;            // transactions whose result is not ESP_OK
+    uint32_t queue_full;        // i2c_async_submit calls that timed out on a full queue
+    uint32_t max_pending;       // highest number of outstanding transactions seen
+    uint64_t busy_us;           // time spent inside i2c_master_cmd_begin, against wall time gives the bus utilisation
+} i2c_async_stats_t;
+
+esp_err_t i2c_async_init(const i2c_async_config_t * config);
+// waits for the queued transactions to finish, then stops the bus task
+esp_err_t i2c_async_deinit(i2c_port_t port);
+
+// Encode and queue a transaction, waits up to wait_ticks for room in the queue. Returns
+// ESP_ERR_TIMEOUT when the queue stayed full. Completion is reported through done_cb, notify_task,
+// or by polling result until it is no longer ESP_ERR_NOT_FINISHED.
+esp_err_t i2c_async_submit(i2c_port_t port, i2c_async_trans_t * trans, TickType_t wait_ticks);
+// block until every transaction submitted so far is done
+esp_err_t i2c_async_flush(i2c_port_t port, TickType_t wait_ticks);
+
+esp_err_t i2c_async_get_stats(i2c_port_t port, i2c_async_stats_t * stats);
+esp_err_t i2c_async_reset_stats(i2c_port_t port);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "i2c_poll_plan.h"
+
+#define TEST_SLOTS      256
+
+static uint32_t failures;
+
+#define TEST_CHECK(cond, ...) do {  \
+    if(!(cond)){                    \
+        printf("FAIL %s:%d ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__);        \
+        printf("\n");               \
+        failures++;                 \
+    }                               \
+} while(0)
+
+static void test_load(void)
+{
+    i2c_poll_plan_t plan;
+    i2c_poll_plan_init(&plan);
+    TEST_CHECK(i2c_poll_plan_add(&plan, 1000, 0, 600) == 0, "600 permille");
+    TEST_CHECK(i2c_poll_plan_load_permille(&plan) == 600, "load %" PRIu32, i2c_poll_plan_load_permille(&plan));
+    TEST_CHECK(i2c_poll_plan_add(&plan, 1000, 0, 500) < 0, "1100 permille accepted");
+    TEST_CHECK(i2c_poll_plan_add(&plan, 2000, 0, 800) == 1, "1000 permille refused");
+    TEST_CHECK(i2c_poll_plan_add(&plan, 100000, 0, 100) < 0, "1001 permille accepted");
+    TEST_CHECK(plan.count == 2, "count %" PRIu32, plan.count);
+    TEST_CHECK(i2c_poll_plan_add(&plan, 0, 0, 1) < 0, "period 0 accepted");
+}
+
+// devices with the same period get phases whose transactions do not overlap, the dry run is EDF
+// and serves every release at once
+static void test_phases(void)
+{
+    i2c_poll_plan_t plan;
+    i2c_poll_slot_t slots[TEST_SLOTS];
+    i2c_poll_plan_init(&plan);
+    for(int i = 0; i < 4; i++){
+        TEST_CHECK(i2c_poll_plan_add(&plan, 10000, 0, 1000) == i, "add %d", i);
+    }
+    for(uint32_t i = 0; i < plan.count; i++){
+        for(uint32_t j = i + 1; j < plan.count; j++){
+            uint32_t a = plan.dev[i].phase_us, b = plan.dev[j].phase_us;
+            uint32_t gap = (a > b) ? a - b : b - a;
+            if(gap > 5000){
+                gap = 10000 - gap;
+            }
+            TEST_CHECK(gap >= 1000, "phases %" PRIu32 " and %" PRIu32 " overlap", a, b);
+        }
+    }
+    i2c_poll_plan_start(&plan, 0);
+    size_t n = i2c_poll_plan_build(&plan, 100000, slots, TEST_SLOTS);
+    TEST_CHECK(n == 40, "%u transactions in 100 ms", (unsigned)n);
+    uint64_t end = 0;
+    for(size_t i = 0; i < n; i++){
+        TEST_CHECK(slots[i].start_us >= end, "slot %u overlaps the previous one", (unsigned)i);
+        TEST_CHECK(slots[i].start_us == slots[i].release_us, "slot %u waited %" PRIu64 " us", (unsigned)i, slots[i].start_us - slots[i].release_us);
+        end = slots[i].start_us + plan.dev[slots[i].dev].duration_us;
+        TEST_CHECK(end <= slots[i].deadline_us, "slot %u misses its deadline", (unsigned)i);
+    }
+
+    //two releases at once: the earlier deadline goes first
+    i2c_poll_plan_init(&plan);
+    i2c_poll_plan_add(&plan, 10000, 5000, 100);
+    i2c_poll_plan_add(&plan, 10000, 1000, 100);
+    plan.dev[0].phase_us = plan.dev[1].phase_us = 0;
+    i2c_poll_plan_start(&plan, 0);
+    i2c_poll_slot_t slot;
+    i2c_poll_plan_next(&plan, 0, &slot);
+    TEST_CHECK(slot.dev == 1, "EDF picked device %d", slot.dev);
+    TEST_CHECK(slot.deadline_us == 1000, "deadline %" PRIu64, slot.deadline_us);
+}
+
+static void test_skip_and_miss(void)
+{
+    i2c_poll_plan_t plan;
+    i2c_poll_slot_t slot;
+    i2c_poll_plan_init(&plan);
+    i2c_poll_plan_add(&plan, 1000, 0, 100);
+    i2c_poll_plan_start(&plan, 0);
+
+    //nothing released yet: idle up to the first release
+    plan.dev[0].next_release_us = 500;
+    i2c_poll_plan_next(&plan, 0, &slot);
+    TEST_CHECK(slot.dev < 0 && slot.start_us == 500, "idle slot dev %d start %" PRIu64, slot.dev, slot.start_us);
+
+    //the releases at 500 and 1500 waited a whole period, the one at 2500 is served
+    i2c_poll_plan_next(&plan, 2600, &slot);
+    TEST_CHECK(plan.dev[0].skipped == 2, "skipped %" PRIu32, plan.dev[0].skipped);
+    TEST_CHECK(slot.dev == 0 && slot.release_us == 2500, "release %" PRIu64, slot.release_us);
+    TEST_CHECK(slot.deadline_us == 3500, "deadline %" PRIu64, slot.deadline_us);
+
+    //ends 400 us late
+    i2c_poll_plan_done(&plan, &slot, 3900);
+    TEST_CHECK(plan.dev[0].served == 1, "served %" PRIu32, plan.dev[0].served);
+    TEST_CHECK(plan.dev[0].misses == 1, "misses %" PRIu32, plan.dev[0].misses);
+    TEST_CHECK(plan.dev[0].max_late_us == 400, "max late %" PRIu32, plan.dev[0].max_late_us);
+    TEST_CHECK(plan.dev[0].next_release_us == 3500, "next release %" PRIu64, plan.dev[0].next_release_us);
+
+    //on time, and a smaller miss does not lower max_late_us
+    i2c_poll_plan_next(&plan, 3900, &slot);
+    i2c_poll_plan_done(&plan, &slot, 4000);
+    i2c_poll_plan_next(&plan, 4600, &slot);
+    i2c_poll_plan_done(&plan, &slot, 5600);
+    TEST_CHECK(plan.dev[0].served == 3, "served %" PRIu32, plan.dev[0].served);
+    TEST_CHECK(plan.dev[0].misses == 2, "misses %" PRIu32, plan.dev[0].misses);
+    TEST_CHECK(plan.dev[0].max_late_us == 400, "max late %" PRIu32, plan.dev[0].max_late_us);
+}
+
+void app_main(void)
+{
+    test_load();
+    test_phases();
+    test_skip_and_miss();
+    printf("%s, %" PRIu32 " failures\n", failures ? "FAILED" : "PASSED", failures);
+    //non zero exit status for CI
+    exit(failures ? 1 : 0);
+}
@@ -0,0 +1,178 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string.h>
+#include "i2c_poll_plan.h"
+
+uint32_t i2c_poll_transfer_us(uint32_t freq_hz, size_t write_len, size_t read_len)
+{
+    //START and STOP, then 9 clocks per byte including the address bytes and the ACK
+    uint64_t bits = 2;
+    if(write_len){
+        bits += 9 * (1 + write_len);
+    }
+    if(read_len){
+        bits += 9 * (1 + read_len) + (write_len ? 1 : 0);
+    }
+    if(!freq_hz){
+        freq_hz = 100000;
+    }
+    return (uint32_t)((bits * 1000000 + freq_hz - 1) / freq_hz);
+}
+
+void i2c_poll_plan_init(i2c_poll_plan_t * plan)
+{
+    memset(plan, 0, sizeof(*plan));
+}
+
+uint32_t i2c_poll_plan_load_permille(const i2c_poll_plan_t * plan)
+{
+    uint64_t load = 0;
+    for(uint32_t i = 0; i < plan->count; i++){
+        load += (uint64_t)plan->dev[i].duration_us * 1000 / plan->dev[i].period_us;
+    }
+    return (uint32_t)load;
+}
+
+// releases of a device with this period, duration and phase that overlap a transaction already planned
+static uint32_t i2c_poll_plan_collisions(const i2c_poll_plan_t * plan, uint32_t period_us, uint32_t duration_us, uint32_t phase_us)
+{
+    uint32_t collisions = 0;
+    uint64_t t = phase_us;
+    for(uint32_t k = 0; k < I2C_POLL_PLAN_PHASE_RELEASES; k++, t += period_us){
+        for(uint32_t i = 0; i < plan->count; i++){
+            const i2c_poll_plan_dev_t * d = &plan->dev[i];
+            //distance from the last release of d before t, and to its next one
+            uint32_t since = (uint32_t)((t + d->period_us - d->phase_us % d->period_us) % d->period_us);
+            if(since < d->duration_us || d->period_us - since < duration_us){
+                collisions++;
+            }
+        }
+    }
+    return collisions;
+}
+
+int i2c_poll_plan_add(i2c_poll_plan_t * plan, uint32_t period_us, uint32_t deadline_us, uint32_t duration_us)
+{
+    if(plan->count >= I2C_POLL_PLAN_MAX_DEVICES || !period_us || !duration_us || duration_us > period_us){
+        return -1;
+    }
+    if(i2c_poll_plan_load_permille(plan) + (uint64_t)duration_us * 1000 / period_us > 1000){
+        return -1;
+    }
+    uint32_t best_phase = 0, best_collisions = UINT32_MAX;
+    for(uint32_t step = 0; step < I2C_POLL_PLAN_PHASE_STEPS && best_collisions; step++){
+        uint32_t phase = (uint32_t)((uint64_t)period_us * step / I2C_POLL_PLAN_PHASE_STEPS);
+        uint32_t collisions = i2c_poll_plan_collisions(plan, period_us, duration_us, phase);
+        if(collisions < best_collisions){
+            best_collisions = collisions;
+            best_phase = phase;
+        }
+    }
+    i2c_poll_plan_dev_t * d = &plan->dev[plan->count];
+    memset(d, 0, sizeof(*d));
+    d->period_us = period_us;
+    d->deadline_us = deadline_us ? deadline_us : period_us;
+    d->duration_us = duration_us;
+    d->phase_us = best_phase;
+    return (int)plan->count++;
+}
+
+void i2c_poll_plan_start(i2c_poll_plan_t * plan, uint64_t origin_us)
+{
+    for(uint32_t i = 0; i < plan->count; i++){
+        i2c_poll_plan_dev_t * d = &plan->dev[i];
+        d->next_release_us = origin_us + d->phase_us;
+        d->served = 0;
+        d->misses = 0;
+        d->skipped = 0;
+        d->max_late_us = 0;
+    }
+}
+
+void i2c_poll_plan_next(i2c_poll_plan_t * plan, uint64_t now_us, i2c_poll_slot_t * slot)
+{
+    int best = -1;
+    uint64_t best_deadline = UINT64_MAX, first_release = UINT64_MAX;
+    for(uint32_t i = 0; i < plan->count; i++){
+        i2c_poll_plan_dev_t * d = &plan->dev[i];
+        //a release that waited a whole period is dropped, the next one keeps the sample grid
+        while(now_us >= d->next_release_us + d->period_us){
+            d->next_release_us += d->period_us;
+            d->skipped++;
+        }
+        if(d->next_release_us <= now_us){
+            uint64_t deadline = d->next_release_us + d->deadline_us;
+            if(deadline < best_deadline){
+                best_deadline = deadline;
+                best = (int)i;
+            }
+        } else if(d->next_release_us < first_release){
+            first_release = d->next_release_us;
+        }
+    }
+    slot->dev = best;
+    if(best < 0){
+        slot->release_us = first_release;
+        slot->start_us = first_release;
+        slot->deadline_us = first_release;
+        return;
+    }
+    slot->release_us = plan->dev[best].next_release_us;
+    slot->start_us = now_us;
+    slot->deadline_us = best_deadline;
+}
+
+void i2c_poll_plan_done(i2c_poll_plan_t * plan, const i2c_poll_slot_t * slot, uint64_t end_us)
+{
+    if(slot->dev < 0 || (uint32_t)slot->dev >= plan->count){
+        return;
+    }
+    i2c_poll_plan_dev_t * d = &plan->dev[slot->dev];
+    d->next_release_us = slot->release_us + d->period_us;
+    d->served++;
+    if(end_us > slot->deadline_us){
+        uint64_t late = end_us - slot->deadline_us;
+        d->misses++;
+        if(late > d->max_late_us){
+            d->max_late_us = (late > UINT32_MAX) ? UINT32_MAX : (uint32_t)late;
+        }
+    }
+}
+
+size_t i2c_poll_plan_build(const i2c_poll_plan_t * plan, uint64_t until_us, i2c_poll_slot_t * out, size_t max)
+{
+    i2c_poll_plan_t sim = *plan;
+    i2c_poll_slot_t slot;
+    uint64_t now = UINT64_MAX;
+    size_t n = 0;
+    for(uint32_t i = 0; i < sim.count; i++){
+        if(sim.dev[i].next_release_us < now){
+            now = sim.dev[i].next_release_us;
+        }
+    }
+    while(n < max && now < until_us){
+        i2c_poll_plan_next(&sim, now, &slot);
+        if(slot.dev < 0){
+            //idle up to the next release
+            now = slot.start_us;
+            continue;
+        }
+        out[n++] = slot;
+        now += sim.dev[slot.dev].duration_us;
+        i2c_poll_plan_done(&sim, &slot, now);
+    }
+    return n;
+}
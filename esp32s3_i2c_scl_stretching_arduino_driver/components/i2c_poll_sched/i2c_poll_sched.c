@@ -0,0 +1,260 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "i2c_master_async.h"
+#include "i2c_poll_sched.h"
+
+static const char *TAG = "i2c_poll";
+
+typedef struct {
+    i2c_poll_device_config_t cfg;
+    QueueHandle_t ring;         // i2c_poll_sample_t, filled by the scheduler task
+    uint32_t errors;
+    uint32_t ring_drops;
+} i2c_poll_dev_t;
+
+typedef struct {
+    bool inited;
+    i2c_poll_sched_config_t cfg;
+    i2c_poll_plan_t plan;
+    i2c_poll_dev_t dev[I2C_POLL_PLAN_MAX_DEVICES];
+    esp_timer_handle_t timer;   // wakes the scheduler task at the next release
+    TaskHandle_t task;
+    volatile bool stopping;
+    volatile bool running;
+} i2c_poll_bus_t;
+
+static i2c_poll_bus_t s_bus[I2C_NUM_MAX];
+
+static void i2c_poll_sched_task(void *pv_args);
+
+static void i2c_poll_sched_wake(void *arg)
+{
+    i2c_poll_bus_t * bus = (i2c_poll_bus_t *)arg;
+    if (bus->task) {
+        xTaskNotifyGive(bus->task);
+    }
+}
+
+static i2c_poll_bus_t * i2c_poll_sched_bus(i2c_port_t port)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || !s_bus[port].inited) {
+        return NULL;
+    }
+    return &s_bus[port];
+}
+
+esp_err_t i2c_poll_sched_init(const i2c_poll_sched_config_t * config)
+{
+    if (config == NULL || config->port < 0 || config->port >= I2C_NUM_MAX
+        || config->task_core < -1 || config->task_core >= portNUM_PROCESSORS) {
+        ESP_LOGE(TAG, "Invalid config");
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_poll_bus_t * bus = &s_bus[config->port];
+    if (bus->inited) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset(bus, 0, sizeof(*bus));
+    bus->cfg = *config;
+    i2c_poll_plan_init(&bus->plan);
+    const esp_timer_create_args_t timer_args = {
+        .callback = i2c_poll_sched_wake,
+        .arg = bus,
+        .name = TAG,
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &bus->timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Release timer create failed");
+        return ret;
+    }
+    bus->inited = true;
+    return ESP_OK;
+}
+
+esp_err_t i2c_poll_sched_add(i2c_port_t port, const i2c_poll_device_config_t * device, int * dev_id)
+{
+    i2c_poll_bus_t * bus = i2c_poll_sched_bus(port);
+    if (bus == NULL || bus->task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (device == NULL || device->cmd_len > I2C_POLL_SCHED_CMD_MAX || device->read_len == 0
+        || device->read_len > I2C_POLL_SCHED_READ_MAX || device->period_us == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t duration_us = i2c_poll_transfer_us(bus->cfg.frequency, device->cmd_len, device->read_len) + bus->cfg.overhead_us;
+    int id = i2c_poll_plan_add(&bus->plan, device->period_us, device->deadline_us, duration_us);
+    if (id < 0) {
+        ESP_LOGE(TAG, "Device 0x%02x does not fit, bus load %" PRIu32 "/1000", device->addr, i2c_poll_plan_load_permille(&bus->plan));
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    i2c_poll_dev_t * dev = &bus->dev[id];
+    dev->cfg = *device;
+    dev->ring = xQueueCreate(device->ring_depth ? device->ring_depth : 1, sizeof(i2c_poll_sample_t));
+    if (dev->ring == NULL) {
+        //keep the plan and the device table in step
+        bus->plan.count--;
+        ESP_LOGE(TAG, "Sample queue create failed");
+        return ESP_ERR_NO_MEM;
+    }
+    if (dev_id) {
+        *dev_id = id;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_poll_sched_start(i2c_port_t port)
+{
+    i2c_poll_bus_t * bus = i2c_poll_sched_bus(port);
+    if (bus == NULL || bus->task || bus->plan.count == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    bus->stopping = false;
+    bus->running = true;
+    BaseType_t task_core = (bus->cfg.task_core < 0) ? tskNO_AFFINITY : bus->cfg.task_core;
+    xTaskCreatePinnedToCore(i2c_poll_sched_task, TAG, bus->cfg.task_stack_size, bus, bus->cfg.task_priority, &bus->task, task_core);
+    if (bus->task == NULL) {
+        bus->running = false;
+        ESP_LOGE(TAG, "Scheduler task create failed");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_poll_sched_deinit(i2c_port_t port)
+{
+    i2c_poll_bus_t * bus = i2c_poll_sched_bus(port);
+    if (bus == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (bus->task) {
+        bus->stopping = true;
+        esp_timer_stop(bus->timer);
+        xTaskNotifyGive(bus->task);
+        //the task finishes the transaction on the bus first
+        while (bus->running) {
+            vTaskDelay(1);
+        }
+        bus->task = NULL;
+    }
+    esp_timer_delete(bus->timer);
+    for (uint32_t i = 0; i < bus->plan.count; i++) {
+        vQueueDelete(bus->dev[i].ring);
+    }
+    bus->inited = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_poll_sched_read(i2c_port_t port, int dev_id, i2c_poll_sample_t * sample, TickType_t wait_ticks)
+{
+    i2c_poll_bus_t * bus = i2c_poll_sched_bus(port);
+    if (bus == NULL || dev_id < 0 || (uint32_t)dev_id >= bus->plan.count || sample == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return (xQueueReceive(bus->dev[dev_id].ring, sample, wait_ticks) == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t i2c_poll_sched_get_stats(i2c_port_t port, int dev_id, i2c_poll_device_stats_t * stats)
+{
+    i2c_poll_bus_t * bus = i2c_poll_sched_bus(port);
+    if (bus == NULL || dev_id < 0 || (uint32_t)dev_id >= bus->plan.count || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const i2c_poll_plan_dev_t * d = &bus->plan.dev[dev_id];
+    stats->samples = d->served;
+    stats->errors = bus->dev[dev_id].errors;
+    stats->misses = d->misses;
+    stats->skipped = d->skipped;
+    stats->max_late_us = d->max_late_us;
+    stats->ring_drops = bus->dev[dev_id].ring_drops;
+    return ESP_OK;
+}
+
+const i2c_poll_plan_t * i2c_poll_sched_get_plan(i2c_port_t port)
+{
+    i2c_poll_bus_t * bus = i2c_poll_sched_bus(port);
+    return bus ? &bus->plan : NULL;
+}
+
+static void i2c_poll_sched_push(i2c_poll_dev_t * dev, const i2c_poll_sample_t * sample)
+{
+    if (xQueueSend(dev->ring, sample, 0) != pdTRUE) {
+        //make room by dropping the oldest sample, the reader wants the latest ones
+        i2c_poll_sample_t old;
+        xQueueReceive(dev->ring, &old, 0);
+        xQueueSend(dev->ring, sample, 0);
+        dev->ring_drops++;
+    }
+}
+
+static void i2c_poll_sched_task(void *pv_args)
+{
+    i2c_poll_bus_t * bus = (i2c_poll_bus_t *)pv_args;
+    i2c_async_trans_t trans;
+    i2c_poll_sample_t sample;
+    i2c_poll_slot_t slot;
+
+    //first releases a little ahead, so the first plan round is not already late
+    i2c_poll_plan_start(&bus->plan, esp_timer_get_time() + 1000);
+    while (!bus->stopping) {
+        int64_t now = esp_timer_get_time();
+        i2c_poll_plan_next(&bus->plan, now, &slot);
+        if (slot.dev < 0) {
+            //sleep up to the next release, esp_timer is far finer than the tick
+            esp_timer_start_once(bus->timer, slot.start_us - now);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            esp_timer_stop(bus->timer);
+            continue;
+        }
+        i2c_poll_dev_t * dev = &bus->dev[slot.dev];
+        memset(&trans, 0, sizeof(trans));
+        trans.addr = dev->cfg.addr;
+        trans.write_buf = dev->cfg.cmd;
+        trans.write_len = dev->cfg.cmd_len;
+        trans.read_buf = sample.data;
+        trans.read_len = dev->cfg.read_len;
+        trans.notify_task = xTaskGetCurrentTaskHandle();
+        esp_err_t ret = i2c_async_submit(bus->cfg.port, &trans, portMAX_DELAY);
+        if (ret == ESP_OK) {
+            //a stop request may wake this task early, the transaction is done once result is set
+            while (__atomic_load_n(&trans.result, __ATOMIC_ACQUIRE) == ESP_ERR_NOT_FINISHED) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+            ret = trans.result;
+        } else {
+            trans.start_us = trans.end_us = esp_timer_get_time();
+        }
+        i2c_poll_plan_done(&bus->plan, &slot, trans.end_us);
+        sample.release_us = slot.release_us;
+        sample.start_us = trans.start_us;
+        sample.end_us = trans.end_us;
+        sample.result = ret;
+        sample.len = dev->cfg.read_len;
+        if (ret != ESP_OK) {
+            dev->errors++;
+        }
+        i2c_poll_sched_push(dev, &sample);
+    }
+    bus->running = false;
+    vTaskDelete(NULL);
+}
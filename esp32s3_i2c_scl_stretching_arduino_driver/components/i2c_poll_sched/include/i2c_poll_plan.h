@@ -0,0 +1,84 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Packing logic of the poll scheduler: periodic device reads on one bus, served non-preemptively
+// in earliest deadline first order. Plain C without any IDF dependency, so it also builds on the host.
+// Times are absolute microseconds of whatever clock the caller uses.
+
+#define I2C_POLL_PLAN_MAX_DEVICES   16
+// phases tried per device when it is added, evenly spread over its period
+#define I2C_POLL_PLAN_PHASE_STEPS   32
+// releases of the new device checked per phase candidate
+#define I2C_POLL_PLAN_PHASE_RELEASES 256
+
+typedef struct {
+    uint32_t period_us;
+    uint32_t deadline_us;       // relative to the release, the transaction must end by then
+    uint32_t duration_us;       // bus time of one transaction
+    uint32_t phase_us;          // first release after the origin, picked by i2c_poll_plan_add
+    uint64_t next_release_us;
+    uint32_t served;            // transactions done
+    uint32_t misses;            // transactions that ended after their deadline
+    uint32_t skipped;           // releases dropped because a whole period went by unserved
+    uint32_t max_late_us;       // worst end past the deadline
+} i2c_poll_plan_dev_t;
+
+typedef struct {
+    i2c_poll_plan_dev_t dev[I2C_POLL_PLAN_MAX_DEVICES];
+    uint32_t count;
+} i2c_poll_plan_t;
+
+typedef struct {
+    int dev;                    // device index, -1 when nothing is released: the bus idles until start_us
+    uint64_t release_us;
+    uint64_t start_us;
+    uint64_t deadline_us;
+} i2c_poll_slot_t;
+
+// bus time of a write, a read, or a write + repeated START + read at freq_hz, ACK bits included
+uint32_t i2c_poll_transfer_us(uint32_t freq_hz, size_t write_len, size_t read_len);
+
+void i2c_poll_plan_init(i2c_poll_plan_t * plan);
+// Add a device and give it the phase that collides least with the releases already planned.
+// deadline_us 0 means the period. Returns the device index, or -1 when the plan is full or the
+// bus load would go over 100%.
+int i2c_poll_plan_add(i2c_poll_plan_t * plan, uint32_t period_us, uint32_t deadline_us, uint32_t duration_us);
+// bus load of the planned devices, in 1/1000
+uint32_t i2c_poll_plan_load_permille(const i2c_poll_plan_t * plan);
+// set the first release of every device to origin_us + its phase and clear the counters
+void i2c_poll_plan_start(i2c_poll_plan_t * plan, uint64_t origin_us);
+
+// the transaction to run at now_us, or the idle gap up to the next release
+void i2c_poll_plan_next(i2c_poll_plan_t * plan, uint64_t now_us, i2c_poll_slot_t * slot);
+// the transaction of slot ended at end_us: schedule the next release and count a deadline miss
+void i2c_poll_plan_done(i2c_poll_plan_t * plan, const i2c_poll_slot_t * slot, uint64_t end_us);
+
+// Dry run of a started plan up to until_us with the planned durations, without touching it.
+// Fills out with up to max transactions in time order and returns their count.
+size_t i2c_poll_plan_build(const i2c_poll_plan_t * plan, uint64_t until_us, i2c_poll_slot_t * out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
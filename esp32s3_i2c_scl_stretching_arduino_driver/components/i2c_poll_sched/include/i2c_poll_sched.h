@@ -0,0 +1,97 @@
+// Copyright 2022-2023 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/i2c.h"
+#include "i2c_poll_plan.h"
+
+// Periodic multi-device polling on one master port. Each device registers a read and a period, the
+// scheduler task runs them in the order of i2c_poll_plan.h through i2c_master_async, timed with
+// esp_timer, and queues the samples per device. i2c_async_init must have been called for the port.
+
+#define I2C_POLL_SCHED_CMD_MAX  4   // command bytes written before the repeated START
+#define I2C_POLL_SCHED_READ_MAX 16  // bytes read per sample
+
+typedef struct {
+    uint16_t addr;              // 7 bit slave address
+    uint8_t cmd[I2C_POLL_SCHED_CMD_MAX];
+    uint8_t cmd_len;            // 0 for a plain read
+    uint8_t read_len;           // 1 .. I2C_POLL_SCHED_READ_MAX
+    uint32_t period_us;
+    uint32_t deadline_us;       // relative to the release, 0 for the period
+    size_t ring_depth;          // samples kept for the reader, the oldest is dropped when full
+} i2c_poll_device_config_t;
+
+typedef struct {
+    int64_t release_us;         // planned sample time
+    int64_t start_us;           // the transfer started, minus release_us is the jitter
+    int64_t end_us;
+    esp_err_t result;
+    uint8_t len;
+    uint8_t data[I2C_POLL_SCHED_READ_MAX];
+} i2c_poll_sample_t;
+
+typedef struct {
+    uint32_t samples;           // transactions done
+    uint32_t errors;            // transactions that did not return ESP_OK
+    uint32_t misses;            // transactions that ended after their deadline
+    uint32_t skipped;           // releases dropped because a whole period went by unserved
+    uint32_t max_late_us;       // worst end past the deadline
+    uint32_t ring_drops;        // samples dropped because the reader did not keep up
+} i2c_poll_device_stats_t;
+
+typedef struct {
+    i2c_port_t port;
+    uint32_t frequency;         // bus frequency, for the transfer time estimate
+    uint32_t overhead_us;       // driver time added to each estimate
+    uint32_t task_priority;
+    uint32_t task_stack_size;
+    int task_core;              // -1 for any core
+} i2c_poll_sched_config_t;
+
+#define I2C_POLL_SCHED_CONFIG_DEFAULT(port_num, freq) { \
+    .port = (port_num),             \
+    .frequency = (freq),            \
+    .overhead_us = 50,              \
+    .task_priority = 12,            \
+    .task_stack_size = 3072,        \
+    .task_core = -1,                \
+}
+
+esp_err_t i2c_poll_sched_init(const i2c_poll_sched_config_t * config);
+// before i2c_poll_sched_start, ESP_ERR_NOT_SUPPORTED when the bus load would go over 100%
+esp_err_t i2c_poll_sched_add(i2c_port_t port, const i2c_poll_device_config_t * device, int * dev_id);
+esp_err_t i2c_poll_sched_start(i2c_port_t port);
+// stops after the transaction on the bus and frees the sample queues
+esp_err_t i2c_poll_sched_deinit(i2c_port_t port);
+
+// next sample of a device, waits up to wait_ticks, ESP_ERR_TIMEOUT when none came
+esp_err_t i2c_poll_sched_read(i2c_port_t port, int dev_id, i2c_poll_sample_t * sample, TickType_t wait_ticks);
+esp_err_t i2c_poll_sched_get_stats(i2c_port_t port, int dev_id, i2c_poll_device_stats_t * stats);
+// the plan the scheduler follows, e.g. to print it with i2c_poll_plan_build
+const i2c_poll_plan_t * i2c_poll_sched_get_plan(i2c_port_t port);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp32-hal-i2c-slave.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "dual-port";
+
+#define DUAL_BUF_LEN 1024
+
+typedef struct {
+    int sda;
+    int scl;
+    uint16_t addr;
+    int core;                   // worker task and interrupt of the port
+} dual_port_cfg_t;
+
+static const dual_port_cfg_t dual_ports[SOC_I2C_NUM] = {
+    { CONFIG_DUAL_SLAVE0_SDA, CONFIG_DUAL_SLAVE0_SCL, CONFIG_DUAL_SLAVE0_ADDRESS, 0 },
+#if SOC_I2C_NUM > 1
+    { CONFIG_DUAL_SLAVE1_SDA, CONFIG_DUAL_SLAVE1_SCL, CONFIG_DUAL_SLAVE1_ADDRESS, portNUM_PROCESSORS - 1 },
+#endif
+};
+
+static uint8_t dual_response[CONFIG_DUAL_READ_LEN];
+
+static void dual_on_request(uint8_t num, uint8_t *cmd, uint8_t cmd_len, void * arg)
+{
+    i2cSlaveWrite(num, dual_response, sizeof(dual_response), 0);
+}
+
+static void dual_on_receive(uint8_t num, uint8_t * data, size_t len, bool stop, void * arg)
+{
+    //nothing to do, the driver statistics count the bytes
+}
+
+// smallest stretch time covering 99% of the master reads in the histogram delta, in us
+static uint32_t dual_stretch_p99(const i2c_slave_stats_t * now, const i2c_slave_stats_t * last)
+{
+    uint32_t total = 0, seen = 0;
+    for(int i = 0; i < I2C_SLAVE_STRETCH_HIST_BINS; i++){
+        total += now->stretch_hist[i] - last->stretch_hist[i];
+    }
+    if(!total){
+        return 0;
+    }
+    for(int i = 0; i < I2C_SLAVE_STRETCH_HIST_BINS; i++){
+        seen += now->stretch_hist[i] - last->stretch_hist[i];
+        if(seen * 100ULL >= total * 99ULL){
+            return 1UL << i;
+        }
+    }
+    return 1UL << (I2C_SLAVE_STRETCH_HIST_BINS - 1);
+}
+
+void app_main(void)
+{
+    for(size_t i = 0; i < sizeof(dual_response); i++){
+        dual_response[i] = (uint8_t)i;
+    }
+
+    for(uint8_t num = 0; num < SOC_I2C_NUM; num++){
+        const dual_port_cfg_t * port = &dual_ports[num];
+        i2c_slave_config_t config = I2C_SLAVE_CONFIG_DEFAULT(port->sda, port->scl, port->addr);
+        config.frequency = CONFIG_DUAL_FREQUENCY;
+        config.rx_len = DUAL_BUF_LEN;
+        config.tx_len = DUAL_BUF_LEN;
+        config.task_core = port->core;
+        config.intr_core = port->core;
+        config.intr_shared = false;
+        i2cSlaveSetRxMode(num, I2C_SLAVE_RX_RING);
+        i2cSlaveSetEventDelivery(num, I2C_SLAVE_EVENT_NOTIFY, 0);
+        i2cSlaveAttachCallbacks(num, dual_on_request, dual_on_receive, NULL);
+        ESP_ERROR_CHECK(i2cSlaveInitEx(num, &config));
+        ESP_LOGI(TAG, "port %u: addr 0x%02x sda %d scl %d on core %d", num, port->addr, port->sda, port->scl, port->core);
+    }
+
+    i2c_slave_stats_t last[SOC_I2C_NUM];
+    for(uint8_t num = 0; num < SOC_I2C_NUM; num++){
+        i2cSlaveGetStats(num, &last[num]);
+    }
+    int64_t last_us = esp_timer_get_time();
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_DUAL_REPORT_MS));
+        int64_t now_us = esp_timer_get_time();
+        double secs = (now_us - last_us) / 1e6;
+        last_us = now_us;
+        uint32_t total_trans = 0, total_bytes = 0;
+
+        for(uint8_t num = 0; num < SOC_I2C_NUM; num++){
+            i2c_slave_stats_t now;
+            i2cSlaveGetStats(num, &now);
+            uint32_t trans = (now.rx_transactions - last[num].rx_transactions) + (now.tx_transactions - last[num].tx_transactions);
+            uint32_t bytes = (now.rx_isr_bytes - last[num].rx_isr_bytes) + (now.tx_bytes - last[num].tx_bytes);
+            ESP_LOGI(TAG, "port %u: %.0f trans/s, %.1f KiB/s, stretch p99 < %" PRIu32 " us max %" PRIu32 " us, lost %" PRIu32,
+                num, trans / secs, bytes / secs / 1024, dual_stretch_p99(&now, &last[num]), now.stretch_max_us,
+                (now.rx_overflows - last[num].rx_overflows) + (now.event_overflows - last[num].event_overflows));
+            total_trans += trans;
+            total_bytes += bytes;
+            last[num] = now;
+        }
+        ESP_LOGI(TAG, "total:  %.0f trans/s, %.1f KiB/s", total_trans / secs, total_bytes / secs / 1024);
+    }
+}
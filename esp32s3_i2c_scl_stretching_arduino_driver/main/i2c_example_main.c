@@ -5,10 +5,24 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_idf_version.h"
 #include "driver/i2c.h"
 #include "esp32-hal-i2c-slave.h"
 #include "sdkconfig.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "esp_cpu.h"
+#define bench_cycles() esp_cpu_get_cycle_count()
+#else
+#include "hal/cpu_hal.h"
+#define bench_cycles() cpu_hal_get_cycle_count()
+#endif
 
 static const char *TAG = "i2c-example";
 
@@ -32,35 +46,70 @@ static const char *TAG = "i2c-example";
 #define I2C_MASTER_FREQ_HZ CONFIG_I2C_MASTER_FREQUENCY        /*!< I2C master clock frequency */
 #define I2C_MASTER_TX_BUF_DISABLE 0                           /*!< I2C master doesn't need buffer */
 #define I2C_MASTER_RX_BUF_DISABLE 0                           /*!< I2C master doesn't need buffer */
+#define I2C_MASTER_READ_BATCH CONFIG_I2C_MASTER_READ_BATCH    /*!< register reads chained into one bus session */
 
 SemaphoreHandle_t print_mux = NULL;
 
-static esp_err_t i2c_master_read_slave(i2c_port_t i2c_num, uint8_t command, uint8_t *data_rd, size_t size)
+typedef struct {
+    uint8_t command;    /*!< command byte written before the repeated START */
+    uint8_t *data;      /*!< where the answer goes */
+    size_t size;        /*!< bytes to read, 0 skips the entry */
+} i2c_master_reg_read_t;
+
+#if !CONFIG_I2C_BENCH
+/*
+ * Command link storage for one bus session, the link is encoded here instead of on the heap.
+ * The legacy driver keeps the transfer progress inside the link items, so a link cannot be replayed:
+ * it is re-armed by encoding the next session in place, which costs a few list writes and no allocation.
+ */
+static uint8_t i2c_master_link_buf[I2C_LINK_RECOMMENDED_SIZE(2 * I2C_MASTER_READ_BATCH)];
+
+/**
+ * @brief chain register reads into one bus session
+ *
+ * START, then for each read: address + W, command, repeated START, address + R, data.
+ * The next read follows with a repeated START, a single STOP ends the session.
+ */
+static esp_err_t i2c_master_read_slave_batch(i2c_port_t i2c_num, const i2c_master_reg_read_t *reads, size_t count)
 {
-    if (size == 0) {
-        return ESP_OK;
+    if (count == 0 || count > I2C_MASTER_READ_BATCH) {
+        return ESP_ERR_INVALID_ARG;
     }
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);                                                      //send start bit
-    i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_WRITE, true); //send the bms address and write bit
-    i2c_master_write_byte(cmd, command, true);                                  //send the command to read
-    i2c_master_start(cmd);                                                      //send restart
-    i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_READ, true);  //send the bms address and read bit
-    if(size > 1) {
-        i2c_master_read(cmd, data_rd, size - 1, I2C_MASTER_ACK);                //if more than one byte is to be read request one less than the number of bytes required
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(i2c_master_link_buf, sizeof(i2c_master_link_buf));
+    if (cmd == NULL) {
+        return ESP_ERR_NO_MEM;
     }
-    i2c_master_read(cmd, &data_rd[size - 1], 1, I2C_MASTER_NACK);               //request the last byte and send a NACK
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, portMAX_DELAY);
-    i2c_cmd_link_delete(cmd);
+    bool empty = true;
+    for (size_t i = 0; i < count; i++) {
+        const i2c_master_reg_read_t *rd = &reads[i];
+        if (rd->size == 0) {
+            continue;
+        }
+        empty = false;
+        i2c_master_start(cmd);                                                      //send start bit, or restart after the previous read
+        i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_WRITE, true); //send the bms address and write bit
+        i2c_master_write_byte(cmd, rd->command, true);                              //send the command to read
+        i2c_master_start(cmd);                                                      //send restart
+        i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_READ, true);  //send the bms address and read bit
+        if (rd->size > 1) {
+            i2c_master_read(cmd, rd->data, rd->size - 1, I2C_MASTER_ACK);           //if more than one byte is to be read request one less than the number of bytes required
+        }
+        i2c_master_read(cmd, &rd->data[rd->size - 1], 1, I2C_MASTER_NACK);          //request the last byte and send a NACK
+    }
+    esp_err_t ret = ESP_OK;
+    if (!empty) {
+        i2c_master_stop(cmd);
+        ret = i2c_master_cmd_begin(i2c_num, cmd, portMAX_DELAY);
+    }
+    i2c_cmd_link_delete_static(cmd);
     return ret;
 }
-
+#endif
 
 /**
  * @brief i2c master initialization
  */
-static esp_err_t i2c_master_init(void)
+static esp_err_t i2c_master_init(uint32_t frequency)
 {
     int i2c_master_port = I2C_MASTER_NUM;
     i2c_config_t conf = {
@@ -69,7 +118,7 @@ static esp_err_t i2c_master_init(void)
         .sda_pullup_en = GPIO_PULLUP_ENABLE,
         .scl_io_num = I2C_MASTER_SCL_IO,
         .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+        .master.clk_speed = frequency,
         // .clk_flags = 0,          /*!< Optional, you can use I2C_SCLK_SRC_FLAG_* flags to choose i2c source clock here. */
     };
     esp_err_t err = i2c_param_config(i2c_master_port, &conf);
@@ -79,6 +128,29 @@ static esp_err_t i2c_master_init(void)
     return i2c_driver_install(i2c_master_port, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, 0);
 }
 
+#if CONFIG_I2C_BENCH
+// the benchmark slave answers every read with the pattern and only counts what it receives,
+// logging here would show up in the stretch times
+static uint8_t bench_pattern[DATA_LENGTH];
+static volatile size_t bench_read_len;      /*!< bytes the slave answers a master read with */
+static volatile uint32_t bench_rx_bytes;    /*!< bytes the slave received during the current point */
+
+static void i2c_slave_request_cb(uint8_t num, uint8_t *cmd, uint8_t cmd_len, void * arg)
+{
+    i2cSlaveWrite(num, bench_pattern, bench_read_len, 0);
+}
+
+static bool IRAM_ATTR i2c_slave_isr_request_cb(uint8_t num, const uint8_t *cmd, uint8_t cmd_len, void * arg)
+{
+    size_t len = bench_read_len;
+    return i2cSlaveWriteFromISR(num, bench_pattern, len) == len;
+}
+
+static void i2c_slave_receive_cb(uint8_t num, uint8_t * data, size_t len, bool stop, void * arg)
+{
+    bench_rx_bytes += len;
+}
+#else
 static void i2c_slave_request_cb(uint8_t num, uint8_t *cmd, uint8_t cmd_len, void * arg)
 {
     // please not block or print in this callback function
@@ -86,6 +158,12 @@ static void i2c_slave_request_cb(uint8_t num, uint8_t *cmd, uint8_t cmd_len, voi
     i2cSlaveWrite(I2C_SLAVE_NUM, cmd, cmd_len, 0);
 }
 
+static bool IRAM_ATTR i2c_slave_isr_request_cb(uint8_t num, const uint8_t *cmd, uint8_t cmd_len, void * arg)
+{
+    // runs in the ISR, SCL is released as soon as it returns true
+    return i2cSlaveWriteFromISR(num, cmd, cmd_len) == cmd_len;
+}
+
 static void i2c_slave_receive_cb(uint8_t num, uint8_t * data, size_t len, bool stop, void * arg)
 {
     ESP_LOGI(TAG, "rcv_len: %d", len);
@@ -93,32 +171,222 @@ static void i2c_slave_receive_cb(uint8_t num, uint8_t * data, size_t len, bool s
         ESP_LOGI(TAG, "rcv: %02x ...", data[0]);
     }
 }
+#endif
 
 /**
  * @brief i2c slave initialization
  */
-static esp_err_t i2c_slave_init(void)
+static esp_err_t i2c_slave_init(uint32_t frequency)
 {
     i2cSlaveAttachCallbacks(I2C_SLAVE_NUM, i2c_slave_request_cb, i2c_slave_receive_cb, NULL);
-    return i2cSlaveInit(I2C_SLAVE_NUM, I2C_SLAVE_SDA_IO, I2C_SLAVE_SCL_IO, ESP_SLAVE_ADDR, I2C_MASTER_FREQ_HZ, I2C_SLAVE_RX_BUF_LEN, I2C_SLAVE_TX_BUF_LEN);
+#if CONFIG_I2C_SLAVE_ISR_REQUEST
+    i2cSlaveAttachIsrRequestCallback(I2C_SLAVE_NUM, i2c_slave_isr_request_cb, NULL);
+#endif
+#if CONFIG_I2C_SLAVE_RX_ZERO_COPY
+    i2cSlaveSetRxDelivery(I2C_SLAVE_NUM, I2C_SLAVE_RX_DELIVERY_ZERO_COPY);
+#endif
+#if CONFIG_I2C_SLAVE_RX_MODE_QUEUE
+    i2cSlaveSetRxMode(I2C_SLAVE_NUM, I2C_SLAVE_RX_QUEUE);
+#elif CONFIG_I2C_SLAVE_RX_MODE_RING
+    i2cSlaveSetRxMode(I2C_SLAVE_NUM, I2C_SLAVE_RX_RING);
+#endif
+#if CONFIG_I2C_SLAVE_EVENT_NOTIFY
+    i2cSlaveSetEventDelivery(I2C_SLAVE_NUM, I2C_SLAVE_EVENT_NOTIFY, CONFIG_I2C_SLAVE_EVENT_DEPTH);
+#else
+    i2cSlaveSetEventDelivery(I2C_SLAVE_NUM, I2C_SLAVE_EVENT_QUEUE, CONFIG_I2C_SLAVE_EVENT_DEPTH);
+#endif
+    return i2cSlaveInit(I2C_SLAVE_NUM, I2C_SLAVE_SDA_IO, I2C_SLAVE_SCL_IO, ESP_SLAVE_ADDR, frequency, I2C_SLAVE_RX_BUF_LEN, I2C_SLAVE_TX_BUF_LEN);
 }
 
+#if !CONFIG_I2C_BENCH
 static void i2c_master_task(void *arg)
 {
-    uint8_t data_rd[1] = {0};
+    uint8_t data_rd[I2C_MASTER_READ_BATCH] = {0};
+    i2c_master_reg_read_t reads[I2C_MASTER_READ_BATCH];
     uint8_t command = 0x00;
+    uint32_t sessions = 0;
     while (1) {
-        ++command;
-        i2c_master_read_slave(I2C_MASTER_NUM, command, data_rd, 1);
-        ESP_LOGI(TAG, "Master Send Command: %02x, Return: %02x", command, data_rd[0]);
+        for (int i = 0; i < I2C_MASTER_READ_BATCH; i++) {
+            reads[i].command = ++command;
+            reads[i].data = &data_rd[i];
+            reads[i].size = 1;
+        }
+        esp_err_t ret = i2c_master_read_slave_batch(I2C_MASTER_NUM, reads, I2C_MASTER_READ_BATCH);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Master read session failed: %s", esp_err_to_name(ret));
+        }
+        for (int i = 0; i < I2C_MASTER_READ_BATCH; i++) {
+            ESP_LOGI(TAG, "Master Send Command: %02x, Return: %02x", reads[i].command, data_rd[i]);
+        }
+        ++sessions;
+        if (sessions % 50 == 0) {
+            i2c_slave_stats_t stats;
+            i2cSlaveGetStats(I2C_SLAVE_NUM, &stats);
+            ESP_LOGI(TAG, "RX ISR: %" PRIu32 " calls, %" PRIu32 " bytes, %" PRIu64 " cycles", stats.rx_isr_calls, stats.rx_isr_bytes, stats.rx_isr_cycles);
+            ESP_LOGI(TAG, "ISR: %" PRIu32 " calls, %" PRIu64 " cycles, overflows rx %" PRIu32 " event %" PRIu32 " pool %" PRIu32,
+                     stats.isr_calls, stats.isr_cycles, stats.rx_overflows, stats.event_overflows, stats.pool_drops);
+            ESP_LOGI(TAG, "Worker: %" PRIu32 " wake-ups", stats.worker_wakeups);
+            ESP_LOGI(TAG, "Stretch: %" PRIu32 " released, max %" PRIu32 " us", stats.stretches, stats.stretch_max_us);
+            for (int i = 0; i < I2C_SLAVE_STRETCH_HIST_BINS; i++) {
+                if (stats.stretch_hist[i]) {
+                    ESP_LOGI(TAG, "  < %" PRIu32 " us: %" PRIu32, (uint32_t)1 << i, stats.stretch_hist[i]);
+                }
+            }
+        }
         vTaskDelay(200 / portTICK_PERIOD_MS);
     }
     vTaskDelete(NULL);
 }
 
+#else
+typedef enum {
+    BENCH_MIX_WRITE,    /*!< payload written by the master */
+    BENCH_MIX_READ,     /*!< one command byte written, payload read back */
+    BENCH_MIX_MIXED,    /*!< writes and reads in turn */
+} bench_mix_t;
+
+static const char *bench_mix_names[] = { "write", "read", "mixed" };
+static const uint32_t bench_freqs[] = { 100000, 400000, 1000000 };
+static const size_t bench_lens[] = { 1, 8, 32, RW_TEST_LENGTH, DATA_LENGTH / 2 };
+
+static uint8_t bench_link_buf[I2C_LINK_RECOMMENDED_SIZE(2)];
+static uint8_t bench_rd[DATA_LENGTH];
+static uint32_t bench_lat_us[CONFIG_I2C_BENCH_TRANSACTIONS];
+
+/**
+ * @brief one master transaction: START, then the write, then the read after a repeated START, STOP
+ */
+static esp_err_t bench_transfer(const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len)
+{
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(bench_link_buf, sizeof(bench_link_buf));
+    i2c_master_start(cmd);
+    if (wr_len) {
+        i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_WRITE, true);
+        i2c_master_write(cmd, wr, wr_len, true);
+        if (rd_len) {
+            i2c_master_start(cmd);
+        }
+    }
+    if (rd_len) {
+        i2c_master_write_byte(cmd, (ESP_SLAVE_ADDR << 1) | I2C_MASTER_READ, true);
+        i2c_master_read(cmd, rd, rd_len, I2C_MASTER_LAST_NACK);
+    }
+    i2c_master_stop(cmd);
+    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
+    i2c_cmd_link_delete_static(cmd);
+    return ret;
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief one point of the sweep, prints a CSV row
+ *
+ * Reads with restart write the command and read the payload in one transaction, without restart the
+ * command write ends with STOP and the read is a second transaction. Latency is the master view, from
+ * before the first i2c_master_cmd_begin to after the last, measured with the CPU cycle counter, which is
+ * per core: the bench task is pinned to CONFIG_I2C_BENCH_CORE. Only bytes that reach receive_cb are counted: the command byte of a restart read goes to the
+ * request callback instead.
+ */
+static uint32_t bench_point(uint32_t freq, bench_mix_t mix, size_t len, bool restart)
+{
+    uint32_t errors = 0, bytes = 0;
+    uint32_t ticks_per_us = esp_rom_get_cpu_ticks_per_us();
+
+    bench_read_len = len;
+    bench_rx_bytes = 0;
+    i2cSlaveResetStats(I2C_SLAVE_NUM);
+    uint32_t expect_rx = 0;
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < CONFIG_I2C_BENCH_TRANSACTIONS; i++) {
+        bool read = (mix == BENCH_MIX_READ) || (mix == BENCH_MIX_MIXED && (i & 1));
+        esp_err_t ret = ESP_OK;
+        uint32_t t0 = bench_cycles();
+        if (!read) {
+            ret = bench_transfer(bench_pattern, len, NULL, 0);
+            expect_rx += len;
+        } else if (restart) {
+            ret = bench_transfer(bench_pattern, 1, bench_rd, len);
+        } else {
+            ret = bench_transfer(bench_pattern, 1, NULL, 0);
+            if (ret == ESP_OK) {
+                ret = bench_transfer(NULL, 0, bench_rd, len);
+            }
+            expect_rx += 1;
+        }
+        bench_lat_us[i] = (bench_cycles() - t0) / ticks_per_us;
+        if (ret != ESP_OK || (read && memcmp(bench_rd, bench_pattern, len))) {
+            errors++;
+        }
+        bytes += len;
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    if (elapsed_us <= 0) {
+        elapsed_us = 1;
+    }
+    //let the worker task hand the last write over
+    vTaskDelay(pdMS_TO_TICKS(20));
+    i2c_slave_stats_t stats;
+    i2cSlaveGetStats(I2C_SLAVE_NUM, &stats);
+    if (bench_rx_bytes != expect_rx) {
+        errors++;
+    }
+
+    qsort(bench_lat_us, CONFIG_I2C_BENCH_TRANSACTIONS, sizeof(bench_lat_us[0]), bench_cmp_u32);
+    printf("bench,%" PRIu32 ",%s,%u,%d,%d,%.0f,%.0f,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+           freq, bench_mix_names[mix], (unsigned)len, restart, CONFIG_I2C_BENCH_TRANSACTIONS,
+           CONFIG_I2C_BENCH_TRANSACTIONS * 1e6 / elapsed_us,
+           bytes * 1e6 / elapsed_us,
+           bench_lat_us[CONFIG_I2C_BENCH_TRANSACTIONS / 2],
+           bench_lat_us[(CONFIG_I2C_BENCH_TRANSACTIONS * 99) / 100],
+           bench_lat_us[CONFIG_I2C_BENCH_TRANSACTIONS - 1],
+           stats.stretch_max_us,
+           errors);
+    return errors;
+}
+
+static void i2c_bench_task(void *arg)
+{
+    uint32_t errors = 0;
+    for (size_t i = 0; i < sizeof(bench_pattern); i++) {
+        bench_pattern[i] = (uint8_t)(0xA5 ^ i);
+    }
+    printf("bench,freq_hz,mix,len,restart,trans,trans_per_s,bytes_per_s,lat_p50_us,lat_p99_us,lat_max_us,stretch_max_us,errors\n");
+    for (size_t f = 0; f < sizeof(bench_freqs) / sizeof(bench_freqs[0]); f++) {
+        //both ends run at the point's frequency
+        i2cSlaveDeinit(I2C_SLAVE_NUM);
+        i2c_driver_delete(I2C_MASTER_NUM);
+        if (i2c_slave_init(bench_freqs[f]) != ESP_OK || i2c_master_init(bench_freqs[f]) != ESP_OK) {
+            ESP_LOGE(TAG, "init at %" PRIu32 " Hz failed", bench_freqs[f]);
+            errors++;
+            continue;
+        }
+        for (int mix = BENCH_MIX_WRITE; mix <= BENCH_MIX_MIXED; mix++) {
+            for (size_t l = 0; l < sizeof(bench_lens) / sizeof(bench_lens[0]); l++) {
+                //the STOP variant only changes reads
+                for (int restart = 1; restart >= (mix == BENCH_MIX_WRITE ? 1 : 0); restart--) {
+                    errors += bench_point(bench_freqs[f], mix, bench_lens[l], restart);
+                }
+            }
+        }
+    }
+    printf("bench,done,errors=%" PRIu32 "\n", errors);
+    vTaskDelete(NULL);
+}
+#endif
+
 void app_main(void)
 {
-    ESP_ERROR_CHECK(i2c_slave_init());
-    ESP_ERROR_CHECK(i2c_master_init());
+    ESP_ERROR_CHECK(i2c_slave_init(I2C_MASTER_FREQ_HZ));
+    ESP_ERROR_CHECK(i2c_master_init(I2C_MASTER_FREQ_HZ));
+#if CONFIG_I2C_BENCH
+    //pinned, the latencies are cycle counts of one core
+    xTaskCreatePinnedToCore(i2c_bench_task, "i2c_bench_task", 1024 * 4, NULL, 1, NULL, CONFIG_I2C_BENCH_CORE);
+#else
     xTaskCreate(i2c_master_task, "i2c_master_task", 1024 * 4, NULL, 1, NULL);
+#endif
 }